@@ -1,10 +1,81 @@
 #include "canvas.h"
 #include "cglm/mat3.h"
+#include "cpu_features.h"
 #include <cglm/affine.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*TransformSoaFn)(const CanvasAffine *affine, float *x, float *y, uint32_t count);
+
+static void transform_soa_scalar(const CanvasAffine *m, float *x, float *y, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    vec2 surface;
+    canvas_affine_apply(m, (vec2){x[i], y[i]}, surface);
+    x[i] = surface[0];
+    y[i] = surface[1];
+  }
+}
+
+#if CPU_X86
+CPU_TARGET("sse2") static void transform_soa_sse2(const CanvasAffine *m, float *x, float *y, uint32_t count) {
+  __m128 xx = _mm_set1_ps(m->xx), xy = _mm_set1_ps(m->xy), xc = _mm_set1_ps(m->xc);
+  __m128 yx = _mm_set1_ps(m->yx), yy = _mm_set1_ps(m->yy), yc = _mm_set1_ps(m->yc);
+  __m128 hw = _mm_set1_ps(m->half_width), hh = _mm_set1_ps(m->half_height);
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 wx = _mm_loadu_ps(x + i);
+    __m128 wy = _mm_loadu_ps(y + i);
+    __m128 sx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(xx, wx), _mm_mul_ps(xy, wy)), xc), hw);
+    __m128 sy = _mm_add_ps(hh, _mm_add_ps(_mm_add_ps(_mm_mul_ps(yx, wx), _mm_mul_ps(yy, wy)), yc));
+    _mm_storeu_ps(x + i, sx);
+    _mm_storeu_ps(y + i, sy);
+  }
+  transform_soa_scalar(m, x + i, y + i, count - i);
+}
+
+// 16 points per iteration, no FMA so results match the scalar path
+CPU_TARGET("avx2") static void transform_soa_avx2(const CanvasAffine *m, float *x, float *y, uint32_t count) {
+  __m256 xx = _mm256_set1_ps(m->xx), xy = _mm256_set1_ps(m->xy), xc = _mm256_set1_ps(m->xc);
+  __m256 yx = _mm256_set1_ps(m->yx), yy = _mm256_set1_ps(m->yy), yc = _mm256_set1_ps(m->yc);
+  __m256 hw = _mm256_set1_ps(m->half_width), hh = _mm256_set1_ps(m->half_height);
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    for (int k = 0; k < 16; k += 8) {
+      __m256 wx = _mm256_loadu_ps(x + i + k);
+      __m256 wy = _mm256_loadu_ps(y + i + k);
+      __m256 sx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xx, wx), _mm256_mul_ps(xy, wy)), xc), hw);
+      __m256 sy = _mm256_add_ps(hh, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(yx, wx), _mm256_mul_ps(yy, wy)), yc));
+      _mm256_storeu_ps(x + i + k, sx);
+      _mm256_storeu_ps(y + i + k, sy);
+    }
+  }
+  transform_soa_scalar(m, x + i, y + i, count - i);
+}
+#endif
+
+static TransformSoaFn transform_soa;
+static once_flag transform_soa_once = ONCE_FLAG_INIT;
+
+static void select_transform_soa(void) {
+  transform_soa = transform_soa_scalar;
+#if CPU_X86
+  const CpuFeatures *features = cpu_features();
+  if (features->avx2) {
+    transform_soa = transform_soa_avx2;
+  } else if (features->sse2) {
+    transform_soa = transform_soa_sse2;
+  }
+#endif
+}
 
 // PRIVATE: recompute matrix from state
 void canvas_update_transform(Canvas *canvas) {
-  mat3 scale_mat, translate_mat;
+  mat3 scale_mat, translate_mat, transform;
 
   // Create identity matrices
   glm_mat3_identity(scale_mat);
@@ -21,7 +92,32 @@ void canvas_update_transform(Canvas *canvas) {
   translate_mat[2][1] = -canvas->position[1];
 
   // Final transform = translate * scale
-  glm_mat3_mul(translate_mat, scale_mat, canvas->transform);
+  glm_mat3_mul(translate_mat, scale_mat, transform);
+
+  if (memcmp(transform, canvas->transform, sizeof(mat3)) != 0 || canvas->mapped_width != canvas->width ||
+      canvas->mapped_height != canvas->height || canvas->mapped_resolution_scale != canvas->resolution_scale) {
+    glm_mat3_copy(transform, canvas->transform);
+    canvas->mapped_width = canvas->width;
+    canvas->mapped_height = canvas->height;
+    canvas->mapped_resolution_scale = canvas->resolution_scale;
+    canvas->version++;
+  }
+}
+
+// World to surface rows: the screen transform and center scaled by the resolution.
+// At full resolution the products are exact and this is the screen transform.
+CanvasAffine canvas_affine(const Canvas *canvas) {
+  float r = canvas->resolution_scale;
+  return (CanvasAffine){
+      .xx = canvas->transform[0][0] * r,
+      .xy = canvas->transform[1][0] * r,
+      .xc = canvas->transform[2][0] * r,
+      .yx = canvas->transform[0][1] * r,
+      .yy = canvas->transform[1][1] * r,
+      .yc = canvas->transform[2][1] * r,
+      .half_width = canvas->width / 2.0f * r,
+      .half_height = canvas->height / 2.0f * r,
+  };
 }
 
 // PUBLIC
@@ -33,6 +129,10 @@ void canvas_init(Canvas *canvas, float width, float height) {
   canvas->scale = 1.0f;
   canvas->position[0] = 0.0f;
   canvas->position[1] = 0.0f;
+  canvas->resolution_scale = 1.0f;
+  // Nothing is mapped yet, the first update sets version 1
+  canvas->version = 0;
+  canvas->mapped_width = canvas->mapped_height = -1.0f;
   canvas_update_transform(canvas); // Ensure initial transform is set
 }
 
@@ -47,6 +147,7 @@ void canvas_restore(Canvas *canvas) {
   if (canvas->stack_top > 0) {
     canvas->stack_top--;
     glm_mat3_copy(canvas->stack[canvas->stack_top], canvas->transform);
+    canvas->version++;
   }
 }
 
@@ -61,12 +162,17 @@ void canvas_scale(Canvas *canvas, float scale) {
   canvas_update_transform(canvas);
 }
 
+void canvas_set_resolution_scale(Canvas *canvas, float resolution_scale) {
+  canvas->resolution_scale = resolution_scale;
+  canvas_update_transform(canvas);
+}
+
 void canvas_rotate(Canvas *canvas, float radians) {
   // Optional: if you want rotation support later
   // Not used in update_transform, so would need to be added
 }
 
-void canvas_transform_point(Canvas *canvas, vec2 world, vec2 screen) {
+void canvas_world_to_screen(Canvas *canvas, vec2 world, vec2 screen) {
   vec3 input = {world[0], world[1], 1.0f};
   vec3 result;
   glm_mat3_mulv(canvas->transform, input, result);
@@ -75,7 +181,10 @@ void canvas_transform_point(Canvas *canvas, vec2 world, vec2 screen) {
   screen[1] = canvas->height / 2.0f + result[1];
 }
 
-void canvas_world_to_screen(Canvas *canvas, vec2 world, vec2 screen) { canvas_transform_point(canvas, world, screen); }
+void canvas_transform_point(Canvas *canvas, vec2 world, vec2 surface) {
+  CanvasAffine affine = canvas_affine(canvas);
+  canvas_affine_apply(&affine, world, surface);
+}
 
 void canvas_screen_to_world(Canvas *canvas, vec2 screen, vec2 world) {
   float x = screen[0] - canvas->width / 2.0f;
@@ -91,3 +200,49 @@ void canvas_screen_to_world(Canvas *canvas, vec2 screen, vec2 world) {
   world[0] = result[0];
   world[1] = result[1];
 }
+
+void canvas_surface_to_world(Canvas *canvas, vec2 surface, vec2 world) {
+  vec2 screen = {surface[0] / canvas->resolution_scale, surface[1] / canvas->resolution_scale};
+  canvas_screen_to_world(canvas, screen, world);
+}
+
+void canvas_screen_to_surface(const Canvas *canvas, vec2 screen, vec2 surface) {
+  surface[0] = screen[0] * canvas->resolution_scale;
+  surface[1] = screen[1] * canvas->resolution_scale;
+}
+
+// Rounded up, the last pixel may stick out past the screen and is cropped when shown
+uint32_t canvas_surface_width(const Canvas *canvas) {
+  uint32_t width = (uint32_t)ceilf(canvas->width * canvas->resolution_scale);
+  return width ? width : 1;
+}
+
+uint32_t canvas_surface_height(const Canvas *canvas) {
+  uint32_t height = (uint32_t)ceilf(canvas->height * canvas->resolution_scale);
+  return height ? height : 1;
+}
+
+void canvas_transform_points_soa(const Canvas *canvas, float *x, float *y, uint32_t count) {
+  // The render thread and scene export can get here first at once
+  call_once(&transform_soa_once, select_transform_soa);
+  CanvasAffine affine = canvas_affine(canvas);
+  transform_soa(&affine, x, y, count);
+}
+
+void line_batch_free(LineBatch *batch) {
+  free(batch->x0);
+  free(batch->y0);
+  free(batch->x1);
+  free(batch->y1);
+  *batch = (LineBatch){0};
+}
+
+void line_batch_reserve(LineBatch *batch, uint32_t capacity) {
+  if (capacity <= batch->capacity)
+    return;
+  batch->x0 = realloc(batch->x0, capacity * sizeof(float));
+  batch->y0 = realloc(batch->y0, capacity * sizeof(float));
+  batch->x1 = realloc(batch->x1, capacity * sizeof(float));
+  batch->y1 = realloc(batch->y1, capacity * sizeof(float));
+  batch->capacity = capacity;
+}
@@ -6,16 +6,36 @@
 
 #define CANVAS_STACK_MAX 16
 
+// Line endpoints as structure of arrays for batched transforms, reused across frames
+typedef struct {
+  float *x0;
+  float *y0;
+  float *x1;
+  float *y1;
+  uint32_t count;
+  uint32_t capacity;
+} LineBatch;
+
+// Screen coordinates are window pixels. The surface is drawn at resolution_scale
+// times the screen size and stretched over it, surface coordinates are its pixels.
 typedef struct Canvas {
-  mat3 transform;
+  mat3 transform; // World to screen, without the center offset
   mat3 stack[CANVAS_STACK_MAX];
   int stack_top;
 
-  float width;
+  float width; // Screen size
   float height;
 
   float scale;
   vec2 position;
+  float resolution_scale; // Surface pixels per screen pixel, 1 at full resolution
+
+  // Bumped by canvas_update_transform whenever the world to screen mapping changed,
+  // anything cached in screen space is stale once its version differs. Starts at 1.
+  uint32_t version;
+  float mapped_width;
+  float mapped_height;
+  float mapped_resolution_scale;
 } Canvas;
 
 void canvas_init(Canvas *canvas, float screen_width, float screen_height);
@@ -23,8 +43,50 @@ void canvas_translate(Canvas *canvas, float tx, float ty);
 void canvas_scale(Canvas *canvas, float scale);
 void canvas_rotate(Canvas *canvas, float radians);
 void canvas_update_transform(Canvas *canvas);
+void canvas_set_resolution_scale(Canvas *canvas, float resolution_scale);
 void canvas_world_to_screen(Canvas *canvas, vec2 world, vec2 screen);
 void canvas_screen_to_world(Canvas *canvas, vec2 screen, vec2 world);
-void canvas_transform_point(Canvas *canvas, vec2 world, vec2 screen);
+// World to surface pixels, what the rasterizer draws with
+void canvas_transform_point(Canvas *canvas, vec2 world, vec2 surface);
+
+// Rows of the canvas transform and the surface center, in surface pixels
+typedef struct {
+  float xx, xy, xc; // surface x = xx * x + xy * y + xc + half_width
+  float yx, yy, yc;
+  float half_width, half_height;
+} CanvasAffine;
+
+// Set up once for transforming many points, valid until the canvas changes
+CanvasAffine canvas_affine(const Canvas *canvas);
+// Same operation order as glm_mat3_mulv plus the center offset, matches canvas_transform_point bit for bit
+static inline void canvas_affine_apply(const CanvasAffine *m, const vec2 world, vec2 surface) {
+  float wx = world[0], wy = world[1];
+  surface[0] = (m->xx * wx + m->xy * wy + m->xc) + m->half_width;
+  surface[1] = m->half_height + (m->yx * wx + m->yy * wy + m->yc);
+}
+void canvas_surface_to_world(Canvas *canvas, vec2 surface, vec2 world);
+void canvas_screen_to_surface(const Canvas *canvas, vec2 screen, vec2 surface);
+// Surface size for the screen size and resolution scale, at least a pixel
+uint32_t canvas_surface_width(const Canvas *canvas);
+uint32_t canvas_surface_height(const Canvas *canvas);
+// Surface pixels per world unit, for stroke widths
+static inline float canvas_pixel_scale(const Canvas *canvas) { return canvas->scale * canvas->resolution_scale; }
+
+void line_batch_free(LineBatch *batch);
+void line_batch_reserve(LineBatch *batch, uint32_t capacity);
+static inline void line_batch_push(LineBatch *batch, const vec2 a, const vec2 b) {
+  if (batch->count == batch->capacity) {
+    line_batch_reserve(batch, batch->capacity ? batch->capacity * 2 : 1024);
+  }
+  uint32_t i = batch->count++;
+  batch->x0[i] = a[0];
+  batch->y0[i] = a[1];
+  batch->x1[i] = b[0];
+  batch->y1[i] = b[1];
+}
+
+// World to surface for count points stored as separate x and y arrays, in place.
+// Matches canvas_transform_point bit for bit.
+void canvas_transform_points_soa(const Canvas *canvas, float *x, float *y, uint32_t count);
 
 #endif // CANVAS_H
@@ -1,4 +1,7 @@
 #include "components.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 void transform_points(Position *position, vec2 *in_points, vec2 *out_points, int count) {
 
@@ -9,3 +12,103 @@ void transform_points(Position *position, vec2 *in_points, vec2 *out_points, int
     // printf("OUT %.2f, %.2f\n", out_points[i][0], out_points[i][1]);
   }
 }
+
+void line_world_bounds(const Line *line, const Position *position, LineBounds *out) {
+  float pad = LINE_THICKNESS * 0.5f;
+  out->min[0] = position->pos[0] + fminf(line->a[0], line->b[0]) - pad;
+  out->min[1] = position->pos[1] + fminf(line->a[1], line->b[1]) - pad;
+  out->max[0] = position->pos[0] + fmaxf(line->a[0], line->b[0]) + pad;
+  out->max[1] = position->pos[1] + fmaxf(line->a[1], line->b[1]) + pad;
+  out->valid = true;
+}
+
+void polyline_set_points(Polyline *polyline, const vec2 *points, uint32_t count) {
+  free(polyline->points);
+  polyline->points = count ? malloc(count * sizeof(vec2)) : NULL;
+  if (count) {
+    memcpy(polyline->points, points, count * sizeof(vec2));
+  }
+  polyline->count = count;
+}
+
+void polyline_world_bounds(const Polyline *polyline, const Position *position, LineBounds *out) {
+  float pad = stroke_outset(&polyline->style);
+  glm_vec2_fill(out->min, INFINITY);
+  glm_vec2_fill(out->max, -INFINITY);
+  for (uint32_t i = 0; i < polyline->count; i++) {
+    glm_vec2_minv(out->min, polyline->points[i], out->min);
+    glm_vec2_maxv(out->max, polyline->points[i], out->max);
+  }
+  if (polyline->count == 0) {
+    glm_vec2_zero(out->min);
+    glm_vec2_zero(out->max);
+  }
+  out->min[0] += position->pos[0] - pad;
+  out->min[1] += position->pos[1] - pad;
+  out->max[0] += position->pos[0] + pad;
+  out->max[1] += position->pos[1] + pad;
+  out->valid = true;
+}
+
+ECS_CTOR(Polyline, ptr, { *ptr = (Polyline){0}; })
+ECS_DTOR(Polyline, ptr, { free(ptr->points); })
+ECS_MOVE(Polyline, dst, src, {
+  free(dst->points);
+  *dst = *src;
+  *src = (Polyline){0};
+})
+ECS_COPY(Polyline, dst, src, {
+  polyline_set_points(dst, (const vec2 *)src->points, src->count);
+  dst->style = src->style;
+})
+
+ECS_CTOR(PolylineStroke, ptr, { *ptr = (PolylineStroke){0}; })
+ECS_DTOR(PolylineStroke, ptr, {
+  free(ptr->screen);
+  free(ptr->prims);
+  stroke_strip_free(&ptr->strip);
+})
+ECS_MOVE(PolylineStroke, dst, src, {
+  free(dst->screen);
+  free(dst->prims);
+  stroke_strip_free(&dst->strip);
+  *dst = *src;
+  *src = (PolylineStroke){0};
+})
+// Rebuilt every frame, a copy starts out empty
+ECS_COPY(PolylineStroke, dst, src, {
+  (void)src;
+  dst->prim_count = 0;
+  dst->visible = false;
+})
+
+void components_set_hooks(ecs_world_t *world) {
+  ecs_set_hooks(world, Polyline, {
+                                     .ctor = ecs_ctor(Polyline),
+                                     .dtor = ecs_dtor(Polyline),
+                                     .move = ecs_move(Polyline),
+                                     .copy = ecs_copy(Polyline),
+                                 });
+  ecs_set_hooks(world, PolylineStroke, {
+                                           .ctor = ecs_ctor(PolylineStroke),
+                                           .dtor = ecs_dtor(PolylineStroke),
+                                           .move = ecs_move(PolylineStroke),
+                                           .copy = ecs_copy(PolylineStroke),
+                                       });
+}
+
+void line_batch_append_world(LineBatch *batch, const Line *lines, const Position *positions, int count) {
+  line_batch_reserve(batch, batch->count + count);
+  // Split into one loop per output array so each one vectorizes on its own
+  float *x0 = batch->x0 + batch->count, *y0 = batch->y0 + batch->count;
+  float *x1 = batch->x1 + batch->count, *y1 = batch->y1 + batch->count;
+  for (int i = 0; i < count; i++) {
+    x0[i] = positions[i].pos[0] + lines[i].a[0];
+    x1[i] = positions[i].pos[0] + lines[i].b[0];
+  }
+  for (int i = 0; i < count; i++) {
+    y0[i] = positions[i].pos[1] + lines[i].a[1];
+    y1[i] = positions[i].pos[1] + lines[i].b[1];
+  }
+  batch->count += count;
+}
@@ -1,10 +1,18 @@
 #ifndef COMPONENTS_H
 #define COMPONENTS_H
 
+#include "canvas.h"
 #include "cglm/types.h"
+#include "flecs.h"
+#include "graphics/rasterizer.h"
+#include "graphics/stroke.h"
 #include <cglm/cglm.h>
+#include <stdbool.h>
 #include <stdint.h>
 
+// World-space stroke width every Line is rendered with
+#define LINE_THICKNESS 10.0f
+
 typedef struct {
   vec2 pos;
 } Position;
@@ -19,5 +27,70 @@ typedef struct {
   uint32_t dummy;
 } Selected ;
 
+// World-space bounds of a Line or Polyline as last seen by the renderer, stroke included.
+// Comes with every Line and Polyline, zeroed and not valid until the renderer saw the entity.
+typedef struct {
+  vec2 min;
+  vec2 max;
+  bool valid;
+} LineBounds;
+
+// Screen-space stroke of a Line for the frame being drawn, culled lines are not visible.
+// Kept across frames while the line and the canvas stay the same.
+typedef struct {
+  vec2 a;
+  vec2 b;
+  float thickness;
+  bool visible;
+  uint32_t version;        // Canvas version a and b are for, 0 once the line changed
+  uint32_t visible_serial; // Last RenderFrame the line index found the line in
+} ScreenLine;
+
+// Rasterizer prims of a ScreenLine, ready to be drawn against any clip
+typedef struct {
+  RasterPrim prims[2];
+  int count;
+  uint32_t version; // Same as ScreenLine
+  RasterMode mode;
+} LineQuads;
+
+// Connected path through points, offset by Position and stroked as one strip.
+// Set points with polyline_set_points, the array is owned by the component.
+typedef struct {
+  vec2 *points;
+  uint32_t count;
+  StrokeStyle style; // World-space width
+} Polyline;
+
+// Screen-space stroke of a Polyline for the frame being drawn, reused across frames
+typedef struct {
+  vec2 *screen; // Transformed points
+  uint32_t screen_capacity;
+  StrokeStrip strip;
+  RasterPrim *prims;
+  uint32_t prim_count;
+  uint32_t prim_capacity;
+  bool visible;
+  uint32_t screen_version; // Canvas version of screen and prims, 0 once the path changed
+  uint32_t prim_version;
+} PolylineStroke;
+
+extern ECS_COMPONENT_DECLARE(Position);
+extern ECS_COMPONENT_DECLARE(Line);
+extern ECS_COMPONENT_DECLARE(LineBounds);
+extern ECS_COMPONENT_DECLARE(ScreenLine);
+extern ECS_COMPONENT_DECLARE(LineQuads);
+extern ECS_COMPONENT_DECLARE(Polyline);
+extern ECS_COMPONENT_DECLARE(PolylineStroke);
+
+// Lifecycle hooks of the components owning memory, after ECS_COMPONENT_DEFINE
+void components_set_hooks(ecs_world_t *world);
+
 void transform_points(Position *position, vec2 *in_points, vec2 *out_points, int count);
+void line_world_bounds(const Line *line, const Position *position, LineBounds *out);
+void polyline_set_points(Polyline *polyline, const vec2 *points, uint32_t count);
+void polyline_world_bounds(const Polyline *polyline, const Position *position, LineBounds *out);
+
+// Appends the world-space endpoints of a table's lines
+void line_batch_append_world(LineBatch *batch, const Line *lines, const Position *positions, int count);
 #endif // COMPONENTS_H
@@ -0,0 +1,41 @@
+#include "cpu_features.h"
+#include <threads.h>
+
+#if CPU_X86 && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+static CpuFeatures detect(void) {
+  CpuFeatures features = {0};
+#if CPU_X86 && defined(_MSC_VER)
+  int regs[4];
+  __cpuid(regs, 1);
+  features.sse2 = (regs[3] >> 26) & 1;
+  bool osxsave = (regs[2] >> 27) & 1;
+  unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  bool os_avx = (xcr0 & 0x6) == 0x6;
+  bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+  __cpuidex(regs, 7, 0);
+  features.avx2 = os_avx && ((regs[1] >> 5) & 1);
+  features.avx512f = os_avx512 && ((regs[1] >> 16) & 1);
+#elif CPU_X86
+  __builtin_cpu_init();
+  features.sse2 = __builtin_cpu_supports("sse2");
+  features.avx2 = __builtin_cpu_supports("avx2");
+  features.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+  return features;
+}
+
+static CpuFeatures features;
+static once_flag detect_once = ONCE_FLAG_INIT;
+
+static void detect_features(void) { features = detect(); }
+
+const CpuFeatures *cpu_features(void) {
+  // Fills run on the pool, flecs workers and the render thread, any of them may come first
+  call_once(&detect_once, detect_features);
+  return &features;
+}
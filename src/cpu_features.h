@@ -0,0 +1,29 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_X86 1
+#else
+#define CPU_X86 0
+#endif
+
+// Lets a single function use instructions beyond the compile-time baseline.
+// MSVC accepts any intrinsic without it.
+#if CPU_X86 && (defined(__GNUC__) || defined(__clang__))
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CPU_TARGET(isa)
+#endif
+
+typedef struct {
+  bool sse2;
+  bool avx2;
+  bool avx512f;
+} CpuFeatures;
+
+// Detected once, includes OS support for the wider register files
+const CpuFeatures *cpu_features(void);
+
+#endif // CPU_FEATURES_H
@@ -0,0 +1,68 @@
+#include "damage.h"
+
+static inline long long rect_area(Rect r) { return rect_is_empty(r) ? 0 : (long long)(r.x1 - r.x0) * (r.y1 - r.y0); }
+
+static inline bool rects_touch(Rect a, Rect b) { return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1; }
+
+void damage_reset(Damage *damage) {
+  damage->count = 0;
+  damage->full = false;
+}
+
+void damage_add(Damage *damage, Rect rect) {
+  if (damage->full || rect_is_empty(rect))
+    return;
+
+  // Absorb every rect the new one touches, the union may touch more
+  for (int i = 0; i < damage->count;) {
+    if (rects_touch(damage->rects[i], rect)) {
+      rect = rect_union(rect, damage->rects[i]);
+      damage->rects[i] = damage->rects[--damage->count];
+      i = 0;
+    } else {
+      i++;
+    }
+  }
+
+  if (damage->count < DAMAGE_MAX_RECTS) {
+    damage->rects[damage->count++] = rect;
+    return;
+  }
+
+  int best = 0;
+  long long best_growth = -1;
+  for (int i = 0; i < damage->count; i++) {
+    long long growth = rect_area(rect_union(damage->rects[i], rect)) - rect_area(damage->rects[i]);
+    if (best_growth < 0 || growth < best_growth) {
+      best = i;
+      best_growth = growth;
+    }
+  }
+  // The grown rect may now touch others, re-insert it
+  Rect merged = rect_union(damage->rects[best], rect);
+  damage->rects[best] = damage->rects[--damage->count];
+  damage_add(damage, merged);
+}
+
+void damage_add_full(Damage *damage) {
+  damage->full = true;
+  damage->count = 0;
+}
+
+bool damage_is_empty(const Damage *damage) { return !damage->full && damage->count == 0; }
+
+int damage_clip_rects(const Damage *damage, Rect bounds, Rect out[DAMAGE_MAX_RECTS]) {
+  if (damage->full) {
+    out[0] = bounds;
+    return rect_is_empty(bounds) ? 0 : 1;
+  }
+
+  int count = 0;
+  for (int i = 0; i < damage->count; i++) {
+    Rect rect = rect_intersect(damage->rects[i], bounds);
+    if (!rect_is_empty(rect)) {
+      out[count++] = rect;
+    }
+  }
+  return count;
+}
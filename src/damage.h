@@ -0,0 +1,24 @@
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+#include "graphics/rasterizer.h"
+#include <stdbool.h>
+
+#define DAMAGE_MAX_RECTS 16
+
+// Screen regions whose pixels are stale. Touching rects are merged, past
+// DAMAGE_MAX_RECTS the new rect is merged into the one it grows the least.
+typedef struct {
+  Rect rects[DAMAGE_MAX_RECTS];
+  int count;
+  bool full;
+} Damage;
+
+void damage_reset(Damage *damage);
+void damage_add(Damage *damage, Rect rect);
+void damage_add_full(Damage *damage);
+bool damage_is_empty(const Damage *damage);
+// Damaged rects clipped to bounds, returns how many were written to out
+int damage_clip_rects(const Damage *damage, Rect bounds, Rect out[DAMAGE_MAX_RECTS]);
+
+#endif // DAMAGE_H
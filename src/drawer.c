@@ -1,16 +1,91 @@
 #include "drawer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 // #include <stdio.h>
 
-void draw_context_draw_thick_line(DrawContext *ctx, vec2 start, vec2 end, float thickness, ColorF color) {
+void draw_context_free(DrawContext *ctx) {
+  free(ctx->commands);
+  free(ctx->prims);
+  ctx->commands = NULL;
+  ctx->prims = NULL;
+  ctx->command_count = ctx->command_capacity = 0;
+}
+
+void draw_context_set_clips(DrawContext *ctx, const Rect *clips, int clip_count) {
+  ctx->clips = clips;
+  ctx->clip_count = clips ? clip_count : 0;
+}
+
+void draw_context_set_color(DrawContext *ctx, ColorF color) { ctx->color = pack_color_alpha(color); }
+
+void draw_context_set_blend(DrawContext *ctx, BlendMode blend) { ctx->blend = blend; }
+
+void draw_context_begin(DrawContext *ctx) {
+  ctx->command_count = 0;
+  if (ctx->tiler) {
+    tile_rasterizer_begin(ctx->tiler, &ctx->surface, ctx->clips, ctx->clip_count);
+  }
+}
+
+// Whether anything inside bounds may end up on screen
+static int draw_context_visible(const DrawContext *ctx, Rect bounds) {
+  bounds = rect_intersect(bounds, rasterizer_surface_rect(&ctx->surface));
+  if (rect_is_empty(bounds))
+    return 0;
+  if (!ctx->clips)
+    return 1;
+  for (int i = 0; i < ctx->clip_count; i++) {
+    if (!rect_is_empty(rect_intersect(bounds, ctx->clips[i])))
+      return 1;
+  }
+  return 0;
+}
+
+void draw_context_draw_prims(DrawContext *ctx, const RasterPrim *prims, int count) {
+  if (ctx->tiler) {
+    tile_rasterizer_add_prims(ctx->tiler, prims, count);
+    return;
+  }
+
   Surface *surface = &ctx->surface;
-  vec2 screen_start, screen_end;
+  if (!ctx->clips) {
+    rasterizer_draw_prims(surface, rasterizer_surface_rect(surface), prims, count);
+    return;
+  }
+  for (int i = 0; i < ctx->clip_count; i++) {
+    rasterizer_draw_prims(surface, ctx->clips[i], prims, count);
+  }
+}
 
-  screen_start[0] = start[0];
-  screen_start[1] = start[1];
+static void record_screen_line(DrawContext *ctx, float x0, float y0, float x1, float y1, float thickness) {
+  // Cheap reject before recording, padded for rounding
+  float pad = thickness * 0.5f + 2.0f;
+  Rect bounds = {
+      (int)floorf(fminf(x0, x1) - pad),
+      (int)floorf(fminf(y0, y1) - pad),
+      (int)ceilf(fmaxf(x0, x1) + pad),
+      (int)ceilf(fmaxf(y0, y1) + pad),
+  };
+  if (!draw_context_visible(ctx, bounds))
+    return;
 
-  screen_end[0] = end[0];
-  screen_end[1] = end[1];
+  if (ctx->command_count == ctx->command_capacity) {
+    ctx->command_capacity = ctx->command_capacity ? ctx->command_capacity * 2 : 1024;
+    ctx->commands = realloc(ctx->commands, ctx->command_capacity * sizeof(DrawCommand));
+  }
+  ctx->commands[ctx->command_count++] = (DrawCommand){
+      .p0 = {x0, y0},
+      .p1 = {x1, y1},
+      .thickness = thickness,
+      .color = ctx->blend == BLEND_MODE_REPLACE ? ctx->color : blend_premultiply(ctx->color),
+      .type = thickness < RASTERIZER_THIN_LINE_THRESHOLD ? DRAW_COMMAND_THIN_LINE : DRAW_COMMAND_LINE,
+      .blend = ctx->blend,
+  };
+}
 
+void draw_context_line(DrawContext *ctx, vec2 start, vec2 end, float thickness) {
+  vec2 screen_start, screen_end;
   canvas_transform_point(&ctx->canvas, start, screen_start);
   canvas_transform_point(&ctx->canvas, end, screen_end);
 
@@ -19,10 +94,79 @@ void draw_context_draw_thick_line(DrawContext *ctx, vec2 start, vec2 end, float
   // screen_start[1] = surface->height - screen_start[1] - 1;
   // screen_end[1] = surface->height - screen_end[1] - 1;
 
-  // thickness *= ctx->canvas.scale;
+  record_screen_line(ctx, screen_start[0], screen_start[1], screen_end[0], screen_end[1], thickness);
+}
+
+void draw_context_lines(DrawContext *ctx, LineBatch *lines, float thickness) {
+  canvas_transform_points_soa(&ctx->canvas, lines->x0, lines->y0, lines->count);
+  canvas_transform_points_soa(&ctx->canvas, lines->x1, lines->y1, lines->count);
+  for (uint32_t i = 0; i < lines->count; i++) {
+    record_screen_line(ctx, lines->x0[i], lines->y0[i], lines->x1[i], lines->y1[i], thickness);
+  }
+}
+
+void draw_context_draw_thick_line(DrawContext *ctx, vec2 start, vec2 end, float thickness, ColorF color) {
+  draw_context_set_color(ctx, color);
+  draw_context_line(ctx, start, end, thickness);
+}
+
+// Blended draws last, they depend on what is under them
+static inline uint64_t command_key(const DrawCommand *command) {
+  return (uint64_t)command->blend << 34 | (uint64_t)command->type << 32 | command->color;
+}
+
+// Stable, so draws sharing blend, type and color keep their order
+static void sort_commands(DrawCommand *commands, uint32_t count, DrawCommand *scratch) {
+  if (count < 2)
+    return;
+
+  uint32_t half = count / 2;
+  sort_commands(commands, half, scratch);
+  sort_commands(commands + half, count - half, scratch);
+  if (command_key(&commands[half - 1]) <= command_key(&commands[half]))
+    return;
+
+  memcpy(scratch, commands, half * sizeof(DrawCommand));
+  uint32_t i = 0, j = half, k = 0;
+  while (i < half && j < count) {
+    commands[k++] = command_key(&commands[j]) < command_key(&scratch[i]) ? commands[j++] : scratch[i++];
+  }
+  while (i < half) {
+    commands[k++] = scratch[i++];
+  }
+}
+
+void draw_context_flush(DrawContext *ctx) {
+  if (ctx->command_count > 0) {
+    if (!ctx->prims) {
+      ctx->prims = malloc(DRAW_CONTEXT_BATCH * 2 * sizeof(RasterPrim));
+    }
+    if (!ctx->ordered) {
+      DrawCommand *scratch = malloc((ctx->command_count / 2) * sizeof(DrawCommand));
+      sort_commands(ctx->commands, ctx->command_count, scratch);
+      free(scratch);
+    }
 
-  Point a = {.x = screen_start[0], .y = screen_start[1]};
-  Point b = {.x = screen_end[0], .y = screen_end[1]};
+    // Set up a batch of commands, then hand all of its prims over at once
+    Surface *surface = &ctx->surface;
+    for (uint32_t start = 0; start < ctx->command_count; start += DRAW_CONTEXT_BATCH) {
+      uint32_t end = start + DRAW_CONTEXT_BATCH < ctx->command_count ? start + DRAW_CONTEXT_BATCH : ctx->command_count;
+      int prim_count = 0;
+      for (uint32_t i = start; i < end; i++) {
+        DrawCommand *command = &ctx->commands[i];
+        RasterPrim *prims = &ctx->prims[prim_count];
+        int count = rasterizer_setup_line(surface, command->p0, command->p1, command->thickness, command->color, prims);
+        if (command->blend != BLEND_MODE_REPLACE) {
+          rasterizer_blend_prims(prims, count, command->blend, command->color);
+        }
+        prim_count += count;
+      }
+      draw_context_draw_prims(ctx, ctx->prims, prim_count);
+    }
+    ctx->command_count = 0;
+  }
 
-  rasterizer_draw_thick_line(surface, a, b, thickness, color);
+  if (ctx->tiler) {
+    tile_rasterizer_flush(ctx->tiler);
+  }
 }
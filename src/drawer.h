@@ -3,11 +3,65 @@
 
 #include "canvas.h"
 #include "graphics/rasterizer.h"
+#include "graphics/tile_rasterizer.h"
+#include <stdbool.h>
+
+// Commands set up and handed to the rasterizer at once on flush
+#define DRAW_CONTEXT_BATCH 512
+
+typedef enum {
+  DRAW_COMMAND_THIN_LINE, // Below RASTERIZER_THIN_LINE_THRESHOLD
+  DRAW_COMMAND_LINE,
+} DrawCommandType;
+
+// A recorded draw, endpoints already in screen space
+typedef struct {
+  vec2 p0;
+  vec2 p1;
+  float thickness;
+  uint32_t color; // Premultiplied when blended
+  DrawCommandType type;
+  BlendMode blend;
+} DrawCommand;
 
 typedef struct DrawContext {
     Canvas canvas;
     Surface surface;
+    // Optional, when set draws are binned and rasterized on flush
+    TileRasterizer *tiler;
+    // Optional, when set only pixels inside these rects are touched
+    const Rect *clips;
+    int clip_count;
+
+    // Packed color of the following draws
+    uint32_t color;
+    // Blend mode of the following draws, zero overwrites
+    BlendMode blend;
+    // Keeps submission order on flush instead of sorting by blend, type and color,
+    // needed once overlapping draws of different colors must stack in order
+    bool ordered;
+
+    // Per-frame command buffer, emptied by begin
+    DrawCommand *commands;
+    uint32_t command_count;
+    uint32_t command_capacity;
+    RasterPrim *prims;
 } DrawContext;
 
+void draw_context_free(DrawContext *ctx);
+// clips must stay alive until the next flush, NULL draws to the whole surface
+void draw_context_set_clips(DrawContext *ctx, const Rect *clips, int clip_count);
+void draw_context_set_color(DrawContext *ctx, ColorF color);
+// Blended draws sort after the ones that overwrite unless the context is ordered
+void draw_context_set_blend(DrawContext *ctx, BlendMode blend);
+void draw_context_begin(DrawContext *ctx);
+// Records a line in world space with the current color, culled when off screen
+void draw_context_line(DrawContext *ctx, vec2 start, vec2 end, float thickness);
+// Same for a whole batch, transforms lines to screen space in place
+void draw_context_lines(DrawContext *ctx, LineBatch *lines, float thickness);
 void draw_context_draw_thick_line(DrawContext *ctx, vec2 start, vec2 end, float thickness, ColorF color);
+// Hands prims that are already set up to the rasterizer, in order, bypassing the command buffer
+void draw_context_draw_prims(DrawContext *ctx, const RasterPrim *prims, int count);
+// Rasterizes every recorded command
+void draw_context_flush(DrawContext *ctx);
 #endif
@@ -0,0 +1,207 @@
+#include "blend.h"
+#include "../cpu_features.h"
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+// a * b / 255 rounded, exact for 8-bit inputs
+static inline uint32_t mul_div255(uint32_t a, uint32_t b) {
+  uint32_t x = a * b + 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+uint32_t blend_premultiply(uint32_t color) {
+  uint32_t a = color >> 24;
+  uint32_t r = mul_div255((color >> 16) & 0xff, a);
+  uint32_t g = mul_div255((color >> 8) & 0xff, a);
+  uint32_t b = mul_div255(color & 0xff, a);
+  return a << 24 | r << 16 | g << 8 | b;
+}
+
+uint32_t blend_scale(uint32_t color, uint32_t coverage) {
+  uint32_t rb = (((color & 0xff00ff) * coverage) >> 8) & 0xff00ff;
+  uint32_t ag = (((color >> 8) & 0xff00ff) * coverage) & 0xff00ff00;
+  return rb | ag;
+}
+
+// Per-channel constants of a span, the color is the same across it.
+// Source over scales the destination by 1 - sa.
+static inline uint32_t source_over_factor(uint32_t color) { return (255 - (color >> 24)) * 0x01010101u; }
+
+static inline uint32_t add_factor(uint32_t color) {
+  (void)color;
+  return 0;
+}
+
+// Multiply scales the destination by s + 1 - sa, 1 on alpha
+static inline uint32_t multiply_factor(uint32_t color) {
+  uint32_t inv = 255 - (color >> 24);
+  uint32_t factor = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    uint32_t c = ((color >> shift) & 0xff) + inv;
+    factor |= (c < 255 ? c : 255) << shift;
+  }
+  return factor;
+}
+
+// Each ISA provides the same vector ops on packed 0xAARRGGBB pixels, the
+// kernels below are generated from them. Scalar is one pixel per vector.
+#define scalar_TARGET
+#define scalar_WIDTH 1
+typedef uint32_t scalar_v;
+
+static inline scalar_v scalar_load(const uint32_t *p) { return *p; }
+static inline void scalar_store(uint32_t *p, scalar_v v) { *p = v; }
+static inline scalar_v scalar_set1(uint32_t x) { return x; }
+static inline scalar_v scalar_or(scalar_v a, scalar_v b) { return a | b; }
+
+static inline scalar_v scalar_adds(scalar_v a, scalar_v b) {
+  uint32_t out = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    uint32_t c = ((a >> shift) & 0xff) + ((b >> shift) & 0xff);
+    out |= (c < 255 ? c : 255) << shift;
+  }
+  return out;
+}
+
+static inline scalar_v scalar_mul_div255(scalar_v a, scalar_v b) {
+  uint32_t out = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    out |= mul_div255((a >> shift) & 0xff, (b >> shift) & 0xff) << shift;
+  }
+  return out;
+}
+
+// 255 - alpha in every channel
+static inline scalar_v scalar_alpha_inv(scalar_v v) { return (255 - (v >> 24)) * 0x01010101u; }
+
+#if CPU_X86
+#define sse2_TARGET CPU_TARGET("sse2")
+#define sse2_WIDTH 4
+typedef __m128i sse2_v;
+
+sse2_TARGET static inline sse2_v sse2_load(const uint32_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+sse2_TARGET static inline void sse2_store(uint32_t *p, sse2_v v) { _mm_storeu_si128((__m128i *)p, v); }
+sse2_TARGET static inline sse2_v sse2_set1(uint32_t x) { return _mm_set1_epi32((int)x); }
+sse2_TARGET static inline sse2_v sse2_or(sse2_v a, sse2_v b) { return _mm_or_si128(a, b); }
+sse2_TARGET static inline sse2_v sse2_adds(sse2_v a, sse2_v b) { return _mm_adds_epu8(a, b); }
+
+sse2_TARGET static inline __m128i sse2_div255_epi16(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Widens to 16 bits, two halves of four channels each
+sse2_TARGET static inline sse2_v sse2_mul_div255(sse2_v a, sse2_v b) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+  __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+  return _mm_packus_epi16(sse2_div255_epi16(lo), sse2_div255_epi16(hi));
+}
+
+sse2_TARGET static inline sse2_v sse2_alpha_inv(sse2_v v) {
+  __m128i inv = _mm_srli_epi32(_mm_xor_si128(v, _mm_set1_epi32(-1)), 24);
+  inv = _mm_or_si128(inv, _mm_slli_epi32(inv, 8));
+  return _mm_or_si128(inv, _mm_slli_epi32(inv, 16));
+}
+
+#define avx2_TARGET CPU_TARGET("avx2")
+#define avx2_WIDTH 8
+typedef __m256i avx2_v;
+
+avx2_TARGET static inline avx2_v avx2_load(const uint32_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+avx2_TARGET static inline void avx2_store(uint32_t *p, avx2_v v) { _mm256_storeu_si256((__m256i *)p, v); }
+avx2_TARGET static inline avx2_v avx2_set1(uint32_t x) { return _mm256_set1_epi32((int)x); }
+avx2_TARGET static inline avx2_v avx2_or(avx2_v a, avx2_v b) { return _mm256_or_si256(a, b); }
+avx2_TARGET static inline avx2_v avx2_adds(avx2_v a, avx2_v b) { return _mm256_adds_epu8(a, b); }
+
+avx2_TARGET static inline __m256i avx2_div255_epi16(__m256i x) {
+  x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+// Unpack and pack both work per 128-bit lane, so the pixel order survives
+avx2_TARGET static inline avx2_v avx2_mul_div255(avx2_v a, avx2_v b) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+  __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+  return _mm256_packus_epi16(avx2_div255_epi16(lo), avx2_div255_epi16(hi));
+}
+
+avx2_TARGET static inline avx2_v avx2_alpha_inv(avx2_v v) {
+  __m256i inv = _mm256_srli_epi32(_mm256_xor_si256(v, _mm256_set1_epi32(-1)), 24);
+  inv = _mm256_or_si256(inv, _mm256_slli_epi32(inv, 8));
+  return _mm256_or_si256(inv, _mm256_slli_epi32(inv, 16));
+}
+#endif
+
+// Blend of destination d with premultiplied source s, k is the mode's factor.
+// XRGB destinations are opaque, which drops the terms with 1 - da.
+#define BLEND_source_over(isa, d, k, s, format) isa##_adds(isa##_mul_div255(d, k), s)
+#define BLEND_add(isa, d, k, s, format) isa##_adds(d, s)
+#define BLEND_multiply(isa, d, k, s, format) BLEND_multiply_##format(isa, d, k, s)
+#define BLEND_multiply_xrgb(isa, d, k, s) isa##_mul_div255(d, k)
+#define BLEND_multiply_argb(isa, d, k, s) isa##_adds(isa##_mul_div255(d, k), isa##_mul_div255(s, isa##_alpha_inv(d)))
+
+// Forced into every written pixel
+#define BLEND_ALPHA_xrgb 0xff000000u
+#define BLEND_ALPHA_argb 0u
+
+// One span kernel: whole vectors, then a scalar tail with the same math
+#define BLEND_SPAN_KERNEL(isa, mode, format)                                                                                     \
+  isa##_TARGET static void blend_##mode##_##format##_##isa(uint32_t *dst, uint32_t color, size_t count) {                     \
+    uint32_t k = mode##_factor(color);                                                                                        \
+    isa##_v kv = isa##_set1(k), sv = isa##_set1(color), av = isa##_set1(BLEND_ALPHA_##format);                                \
+    (void)kv, (void)sv;                                                                                                       \
+    for (; count >= isa##_WIDTH; count -= isa##_WIDTH, dst += isa##_WIDTH) {                                                  \
+      isa##_v d = isa##_load(dst);                                                                                            \
+      isa##_store(dst, isa##_or(BLEND_##mode(isa, d, kv, sv, format), av));                                                   \
+    }                                                                                                                         \
+    for (; count; count--, dst++) {                                                                                           \
+      *dst = BLEND_##mode(scalar, *dst, k, color, format) | BLEND_ALPHA_##format;                                             \
+    }                                                                                                                         \
+  }
+
+#define BLEND_SPAN_KERNELS(isa)                                                                                                  \
+  BLEND_SPAN_KERNEL(isa, source_over, xrgb)                                                                                      \
+  BLEND_SPAN_KERNEL(isa, source_over, argb)                                                                                      \
+  BLEND_SPAN_KERNEL(isa, add, xrgb)                                                                                              \
+  BLEND_SPAN_KERNEL(isa, add, argb)                                                                                              \
+  BLEND_SPAN_KERNEL(isa, multiply, xrgb)                                                                                         \
+  BLEND_SPAN_KERNEL(isa, multiply, argb)
+
+#define BLEND_SPAN_ROW(isa)                                                                                                      \
+  {                                                                                                                              \
+      [BLEND_MODE_SOURCE_OVER] = {blend_source_over_xrgb_##isa, blend_source_over_argb_##isa},                                   \
+      [BLEND_MODE_ADD] = {blend_add_xrgb_##isa, blend_add_argb_##isa},                                                           \
+      [BLEND_MODE_MULTIPLY] = {blend_multiply_xrgb_##isa, blend_multiply_argb_##isa},                                            \
+  }
+
+BLEND_SPAN_KERNELS(scalar)
+#if CPU_X86
+BLEND_SPAN_KERNELS(sse2)
+BLEND_SPAN_KERNELS(avx2)
+#endif
+
+// Indexed by fill kernel, mode and format. REPLACE stays on the fill kernels.
+static const FillFn span_kernels[FILL_KERNEL_COUNT][BLEND_MODE_COUNT][PIXEL_FORMAT_COUNT] = {
+    [FILL_KERNEL_SCALAR] = BLEND_SPAN_ROW(scalar),
+#if CPU_X86
+    [FILL_KERNEL_SSE2] = BLEND_SPAN_ROW(sse2),
+    [FILL_KERNEL_AVX2] = BLEND_SPAN_ROW(avx2),
+    // Blending is bound by the 16-bit multiplies, not the store width
+    [FILL_KERNEL_AVX512] = BLEND_SPAN_ROW(avx2),
+#endif
+};
+
+FillFn blend_span(BlendMode mode, PixelFormat format) {
+  if (mode == BLEND_MODE_REPLACE)
+    return fill_u32;
+  return span_kernels[fill_active_kernel()][mode][format];
+}
+
+const char *blend_mode_name(BlendMode mode) {
+  static const char *names[BLEND_MODE_COUNT] = {"replace", "source_over", "add", "multiply"};
+  return mode < BLEND_MODE_COUNT ? names[mode] : "unknown";
+}
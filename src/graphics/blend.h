@@ -0,0 +1,35 @@
+#ifndef BLEND_H
+#define BLEND_H
+
+#include "fill.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// How a prim's color combines with the pixels under it. Every mode but
+// REPLACE takes a premultiplied color, see blend_premultiply.
+typedef enum {
+  BLEND_MODE_REPLACE, // Overwrites, the aliased modes draw it opaque
+  BLEND_MODE_SOURCE_OVER,
+  BLEND_MODE_ADD, // Saturating
+  BLEND_MODE_MULTIPLY,
+  BLEND_MODE_COUNT,
+} BlendMode;
+
+// Layout of a surface's pixels, both 0xAARRGGBB
+typedef enum {
+  PIXEL_FORMAT_XRGB8888, // Alpha is ignored and written as 255
+  PIXEL_FORMAT_ARGB8888, // Premultiplied, alpha is blended like the other channels
+  PIXEL_FORMAT_COUNT,
+} PixelFormat;
+
+// Straight alpha 0xAARRGGBB to premultiplied
+uint32_t blend_premultiply(uint32_t color);
+// Scales a premultiplied color by coverage in [0, 256]
+uint32_t blend_scale(uint32_t color, uint32_t coverage);
+
+// Span kernel blending a premultiplied color over count pixels, for the fill
+// kernel that is active. REPLACE is fill_u32 itself.
+FillFn blend_span(BlendMode mode, PixelFormat format);
+const char *blend_mode_name(BlendMode mode);
+
+#endif // BLEND_H
@@ -0,0 +1,148 @@
+#include "coverage.h"
+#include "blend.h"
+#include <math.h>
+#include <stdbool.h>
+
+// Double, c is millions of pixels for the edges of a far line
+typedef struct {
+  double nx, ny, c; // Signed distance to the edge, positive inside
+} Edge;
+
+// Source over with alpha in [0, 256], two channels per multiply
+static inline uint32_t blend_pixel(uint32_t dst, uint32_t src, uint32_t alpha) {
+  uint32_t inv = 256 - alpha;
+  uint32_t rb = (((src & 0xff00ff) * alpha + (dst & 0xff00ff) * inv) >> 8) & 0xff00ff;
+  uint32_t ag = (((src >> 8) & 0xff00ff) * alpha + ((dst >> 8) & 0xff00ff) * inv) & 0xff00ff00;
+  return rb | ag;
+}
+
+static inline double clamp01(double v) { return v < 0.0 ? 0.0 : (v > 1.0 ? 1.0 : v); }
+
+// Columns of row whose centers are at least t inside every edge, as [*x0, *x1)
+static void row_range(const Edge *edges, int count, double yc, double t, int *x0, int *x1) {
+  double lo = *x0, hi = *x1;
+  for (int i = 0; i < count && lo < hi; i++) {
+    double e = edges[i].ny * yc + edges[i].c;
+    if (fabs(edges[i].nx) < 1e-6) {
+      if (e < t)
+        hi = lo;
+      continue;
+    }
+    // Pixel x has its center at x + 0.5
+    double x = (t - e) / edges[i].nx - 0.5;
+    if (edges[i].nx > 0.0) {
+      lo = fmax(lo, ceil(x));
+    } else {
+      hi = fmin(hi, floor(x) + 1.0);
+    }
+  }
+  *x0 = (int)lo;
+  *x1 = hi > lo ? (int)hi : (int)lo;
+}
+
+// Partial coverages summed, exact for the two sides of a sub-pixel wide strip
+static inline double pixel_coverage(const Edge *edges, int count, double xc, double yc) {
+  double coverage = 1.0;
+  for (int i = 0; i < count; i++) {
+    coverage += clamp01(edges[i].nx * xc + edges[i].ny * yc + edges[i].c + 0.5) - 1.0;
+  }
+  return clamp01(coverage);
+}
+
+// span is NULL for REPLACE, which lerps towards the straight alpha color. The
+// other modes take the premultiplied color scaled by coverage.
+static void blend_pixels(Surface *surface, const Edge *edges, int count, int y, int x0, int x1, uint32_t color, double alpha, FillFn span) {
+  double yc = y + 0.5;
+  for (int x = x0; x < x1; x++) {
+    uint32_t a = (uint32_t)lrint(pixel_coverage(edges, count, x + 0.5, yc) * alpha);
+    if (!a)
+      continue;
+    uint32_t *pixel = rasterizer_pixel(surface, x, y);
+    if (span) {
+      span(pixel, blend_scale(color, a), 1);
+    } else {
+      *pixel = blend_pixel(*pixel, color, a);
+    }
+  }
+}
+
+Rect coverage_polygon_bounds(const AaPolygon *polygon) {
+  int32_t min_x = polygon->x[0], max_x = polygon->x[0];
+  int32_t min_y = polygon->y[0], max_y = polygon->y[0];
+  for (int i = 1; i < polygon->count; i++) {
+    min_x = polygon->x[i] < min_x ? polygon->x[i] : min_x;
+    max_x = polygon->x[i] > max_x ? polygon->x[i] : max_x;
+    min_y = polygon->y[i] < min_y ? polygon->y[i] : min_y;
+    max_y = polygon->y[i] > max_y ? polygon->y[i] : max_y;
+  }
+  return (Rect){(int)floor(aa_polygon_coord(min_x)) - 1, (int)floor(aa_polygon_coord(min_y)) - 1, (int)ceil(aa_polygon_coord(max_x)) + 1,
+                (int)ceil(aa_polygon_coord(max_y)) + 1};
+}
+
+void coverage_draw_polygon(Surface *surface, Rect clip, const AaPolygon *polygon, uint32_t color, BlendMode blend) {
+  int count = polygon->count;
+  double px[AA_POLYGON_MAX_VERTICES], py[AA_POLYGON_MAX_VERTICES];
+  for (int i = 0; i < count; i++) {
+    px[i] = aa_polygon_coord(polygon->x[i]);
+    py[i] = aa_polygon_coord(polygon->y[i]);
+  }
+  // Relative to the first vertex, the products of far coordinates would cancel
+  double area = 0.0;
+  for (int i = 1; i + 1 < count; i++) {
+    area += (px[i] - px[0]) * (py[i + 1] - py[0]) - (px[i + 1] - px[0]) * (py[i] - py[0]);
+  }
+  if (fabs(area) < 1e-6)
+    return;
+
+  Edge edges[AA_POLYGON_MAX_VERTICES];
+  double winding = area > 0.0 ? 1.0 : -1.0;
+  for (int i = 0; i < count; i++) {
+    int j = (i + 1) % count;
+    double dx = px[j] - px[i];
+    double dy = py[j] - py[i];
+    double length = sqrt(dx * dx + dy * dy);
+    if (length == 0.0) {
+      edges[i] = (Edge){0.0, 0.0, 1.0}; // Degenerate edge, never limits coverage
+      continue;
+    }
+    double nx = -dy / length * winding;
+    double ny = dx / length * winding;
+    edges[i] = (Edge){nx, ny, -(nx * px[i] + ny * py[i])};
+  }
+
+  clip = rect_intersect(clip, coverage_polygon_bounds(polygon));
+  FillFn span = blend == BLEND_MODE_REPLACE ? NULL : blend_span(blend, surface->state.format);
+  // Premultiplied colors carry their alpha, coverage alone scales them
+  double alpha = span ? 256.0 : (color >> 24) * (256.0 / 255.0);
+  bool opaque = (color >> 24) == 0xff;
+
+  for (int y = clip.y0; y < clip.y1; y++) {
+    double yc = y + 0.5;
+    int outer_x0 = clip.x0, outer_x1 = clip.x1;
+    row_range(edges, count, yc, -0.5f, &outer_x0, &outer_x1);
+    if (outer_x0 >= outer_x1)
+      continue;
+
+    int inner_x0 = outer_x0, inner_x1 = outer_x1;
+    row_range(edges, count, yc, 0.5f, &inner_x0, &inner_x1);
+    if (inner_x0 >= inner_x1) {
+      blend_pixels(surface, edges, count, y, outer_x0, outer_x1, color, alpha, span);
+      continue;
+    }
+
+    // Soft edges on both sides of a fully covered span
+    blend_pixels(surface, edges, count, y, outer_x0, inner_x0, color, alpha, span);
+    uint32_t *row = rasterizer_pixel(surface, inner_x0, y);
+    if (span) {
+      span(row, color, inner_x1 - inner_x0);
+    } else if (opaque) {
+      fill_u32(row, color, inner_x1 - inner_x0);
+    } else {
+      uint32_t a = (uint32_t)lrint(alpha);
+      for (int x = 0; x < inner_x1 - inner_x0; x++) {
+        row[x] = blend_pixel(row[x], color, a);
+      }
+    }
+    blend_pixels(surface, edges, count, y, inner_x1, outer_x1, color, alpha, span);
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include "rasterizer.h"
+
+// Pixels possibly touched by a polygon, a pixel of slack for the soft edges
+Rect coverage_polygon_bounds(const AaPolygon *polygon);
+
+// Anti-aliased convex polygon. Coverage comes from the signed distance of the
+// pixel center to each edge, so only the pixels within half a pixel of an edge
+// are blended, the rest of each row is a solid span. With BLEND_MODE_REPLACE
+// the color's alpha scales the coverage, the other modes scale the
+// premultiplied color by it.
+void coverage_draw_polygon(Surface *surface, Rect clip, const AaPolygon *polygon, uint32_t color, BlendMode blend);
+
+#endif // COVERAGE_H
@@ -0,0 +1,124 @@
+#include "density.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Counts below this get their ramp index from a table built per tone map
+#define DENSITY_LOG_TABLE 4096
+
+void density_resize(DensityBuffer *density, uint32_t width, uint32_t height) {
+  if (density->counts && density->width == width && density->height == height)
+    return;
+  free(density->counts);
+  density->width = width;
+  density->height = height;
+  density->counts = calloc((size_t)width * height, sizeof(atomic_uint));
+}
+
+void density_free(DensityBuffer *density) {
+  free(density->counts);
+  density->counts = NULL;
+  density->width = density->height = 0;
+}
+
+// atomic_uint is lock-free and has the size of its value, zero bytes are a zero count
+void density_clear(DensityBuffer *density) { memset(density->counts, 0, (size_t)density->width * density->height * sizeof(atomic_uint)); }
+
+void density_set_ramp(DensityBuffer *density, ColorF low, ColorF high) {
+  for (int i = 0; i < DENSITY_RAMP_SIZE; i++) {
+    float t = (float)i / (DENSITY_RAMP_SIZE - 1);
+    ColorF color = {
+        .r = low.r + (high.r - low.r) * t,
+        .g = low.g + (high.g - low.g) * t,
+        .b = low.b + (high.b - low.b) * t,
+        .a = 1.0f,
+    };
+    density->ramp[i] = pack_color(color);
+  }
+}
+
+// Liang-Barsky against one boundary, narrows [t0, t1]
+static int clip_edge(float p, float q, float *t0, float *t1) {
+  if (p == 0.0f)
+    return q >= 0.0f;
+  float t = q / p;
+  if (p < 0.0f) {
+    if (t > *t1)
+      return 0;
+    if (t > *t0)
+      *t0 = t;
+  } else {
+    if (t < *t0)
+      return 0;
+    if (t < *t1)
+      *t1 = t;
+  }
+  return 1;
+}
+
+void density_add_line(DensityBuffer *density, const vec2 p0, const vec2 p1) {
+  float dx = p1[0] - p0[0];
+  float dy = p1[1] - p0[1];
+  float w = (float)density->width;
+  float h = (float)density->height;
+
+  // Only the part on the buffer costs anything
+  float t0 = 0.0f, t1 = 1.0f;
+  if (!clip_edge(-dx, p0[0], &t0, &t1) || !clip_edge(dx, w - p0[0], &t0, &t1) || !clip_edge(-dy, p0[1], &t0, &t1) ||
+      !clip_edge(dy, h - p0[1], &t0, &t1))
+    return;
+
+  float x0 = p0[0] + dx * t0, y0 = p0[1] + dy * t0;
+  float x1 = p0[0] + dx * t1, y1 = p0[1] + dy * t1;
+  float length = fmaxf(fabsf(x1 - x0), fabsf(y1 - y0));
+
+  // Sub-pixel segments land on the pixel of their midpoint
+  int steps = (int)length;
+  float sx = steps ? (x1 - x0) / steps : 0.0f;
+  float sy = steps ? (y1 - y0) / steps : 0.0f;
+  float x = steps ? x0 : (x0 + x1) * 0.5f;
+  float y = steps ? y0 : (y0 + y1) * 0.5f;
+
+  for (int i = 0; i <= steps; i++, x += sx, y += sy) {
+    int px = (int)x, py = (int)y;
+    if (px < 0 || py < 0 || px >= (int)density->width || py >= (int)density->height)
+      continue;
+    atomic_fetch_add_explicit(&density->counts[(size_t)py * density->width + px], 1, memory_order_relaxed);
+  }
+}
+
+void density_tone_map(const DensityBuffer *density, Surface *surface, Rect clip) {
+  clip = rect_intersect(clip, rasterizer_surface_rect(surface));
+  clip = rect_intersect(clip, (Rect){0, 0, (int)density->width, (int)density->height});
+  if (rect_is_empty(clip))
+    return;
+
+  uint32_t max = 0;
+  size_t total = (size_t)density->width * density->height;
+  for (size_t i = 0; i < total; i++) {
+    uint32_t count = atomic_load_explicit(&density->counts[i], memory_order_relaxed);
+    max = count > max ? count : max;
+  }
+  if (max == 0)
+    return;
+
+  // log1p(count) / log1p(max) onto the ramp, one log per distinct small count
+  float scale = (DENSITY_RAMP_SIZE - 1) / log1pf((float)max);
+  uint8_t table[DENSITY_LOG_TABLE];
+  uint32_t table_size = max < DENSITY_LOG_TABLE ? max + 1 : DENSITY_LOG_TABLE;
+  for (uint32_t c = 1; c < table_size; c++) {
+    table[c] = (uint8_t)(log1pf((float)c) * scale);
+  }
+
+  for (int y = clip.y0; y < clip.y1; y++) {
+    const atomic_uint *counts = &density->counts[(size_t)y * density->width];
+    uint32_t *row = &surface->buffer[(size_t)y * surface->width];
+    for (int x = clip.x0; x < clip.x1; x++) {
+      uint32_t count = atomic_load_explicit(&counts[x], memory_order_relaxed);
+      if (count == 0)
+        continue;
+      int index = count < table_size ? table[count] : (int)(log1pf((float)count) * scale);
+      row[x] = density->ramp[index];
+    }
+  }
+}
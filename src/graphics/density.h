@@ -0,0 +1,32 @@
+#ifndef DENSITY_H
+#define DENSITY_H
+
+#include "rasterizer.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define DENSITY_RAMP_SIZE 256
+
+// Per-pixel hit counts for lines too small to be worth setting up, shown by
+// mapping log(count) onto a color ramp instead of drawing every stroke.
+typedef struct {
+  atomic_uint *counts;
+  uint32_t width;
+  uint32_t height;
+  uint32_t ramp[DENSITY_RAMP_SIZE]; // Packed, lowest density first
+} DensityBuffer;
+
+void density_resize(DensityBuffer *density, uint32_t width, uint32_t height);
+void density_free(DensityBuffer *density);
+void density_clear(DensityBuffer *density);
+void density_set_ramp(DensityBuffer *density, ColorF low, ColorF high);
+
+// One hit per pixel along the major axis of the segment, in screen space.
+// Safe to call from several threads at once.
+void density_add_line(DensityBuffer *density, const vec2 p0, const vec2 p1);
+
+// Writes the ramp color of every pixel with hits inside clip, the others keep their color.
+// Counts are log scaled against the largest one in the buffer.
+void density_tone_map(const DensityBuffer *density, Surface *surface, Rect clip);
+
+#endif // DENSITY_H
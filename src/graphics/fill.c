@@ -0,0 +1,213 @@
+#include "fill.h"
+#include "../cpu_features.h"
+#include <threads.h>
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+static void fill_scalar(uint32_t *dst, uint32_t value, size_t count) {
+  while (count--) {
+    *dst++ = value;
+  }
+}
+
+// Scalar head until dst is aligned to `align` bytes, returns pixels left
+static inline size_t fill_head(uint32_t **dst, uint32_t value, size_t count, uintptr_t align) {
+  while (count && ((uintptr_t)*dst & (align - 1))) {
+    *(*dst)++ = value;
+    count--;
+  }
+  return count;
+}
+
+#if CPU_X86
+CPU_TARGET("sse2") static void fill_sse2(uint32_t *dst, uint32_t value, size_t count) {
+  count = fill_head(&dst, value, count, 16);
+  __m128i v = _mm_set1_epi32((int)value);
+  for (; count >= 16; count -= 16, dst += 16) {
+    _mm_store_si128((__m128i *)dst + 0, v);
+    _mm_store_si128((__m128i *)dst + 1, v);
+    _mm_store_si128((__m128i *)dst + 2, v);
+    _mm_store_si128((__m128i *)dst + 3, v);
+  }
+  for (; count >= 4; count -= 4, dst += 4) {
+    _mm_store_si128((__m128i *)dst, v);
+  }
+  fill_scalar(dst, value, count);
+}
+
+CPU_TARGET("sse2") static void fill_stream_sse2(uint32_t *dst, uint32_t value, size_t count) {
+  count = fill_head(&dst, value, count, 16);
+  __m128i v = _mm_set1_epi32((int)value);
+  for (; count >= 16; count -= 16, dst += 16) {
+    _mm_stream_si128((__m128i *)dst + 0, v);
+    _mm_stream_si128((__m128i *)dst + 1, v);
+    _mm_stream_si128((__m128i *)dst + 2, v);
+    _mm_stream_si128((__m128i *)dst + 3, v);
+  }
+  _mm_sfence();
+  fill_sse2(dst, value, count);
+}
+
+CPU_TARGET("avx2") static void fill_avx2(uint32_t *dst, uint32_t value, size_t count) {
+  // Short spans are the common case, don't pay for alignment
+  if (count < 16) {
+    fill_scalar(dst, value, count);
+    return;
+  }
+  __m256i v = _mm256_set1_epi32((int)value);
+  // Unaligned first store, then continue from the next 32 byte boundary
+  _mm256_storeu_si256((__m256i *)dst, v);
+  size_t skip = (32 - ((uintptr_t)dst & 31)) / sizeof(uint32_t);
+  dst += skip;
+  count -= skip;
+  for (; count >= 32; count -= 32, dst += 32) {
+    _mm256_store_si256((__m256i *)dst + 0, v);
+    _mm256_store_si256((__m256i *)dst + 1, v);
+    _mm256_store_si256((__m256i *)dst + 2, v);
+    _mm256_store_si256((__m256i *)dst + 3, v);
+  }
+  for (; count >= 8; count -= 8, dst += 8) {
+    _mm256_store_si256((__m256i *)dst, v);
+  }
+  // Overlapping unaligned tail
+  if (count) {
+    _mm256_storeu_si256((__m256i *)(dst + count - 8), v);
+  }
+}
+
+CPU_TARGET("avx2") static void fill_stream_avx2(uint32_t *dst, uint32_t value, size_t count) {
+  count = fill_head(&dst, value, count, 32);
+  __m256i v = _mm256_set1_epi32((int)value);
+  for (; count >= 32; count -= 32, dst += 32) {
+    _mm256_stream_si256((__m256i *)dst + 0, v);
+    _mm256_stream_si256((__m256i *)dst + 1, v);
+    _mm256_stream_si256((__m256i *)dst + 2, v);
+    _mm256_stream_si256((__m256i *)dst + 3, v);
+  }
+  _mm_sfence();
+  fill_scalar(dst, value, count);
+}
+
+CPU_TARGET("avx512f") static void fill_avx512(uint32_t *dst, uint32_t value, size_t count) {
+  if (count < 16) {
+    fill_scalar(dst, value, count);
+    return;
+  }
+  __m512i v = _mm512_set1_epi32((int)value);
+  _mm512_storeu_si512(dst, v);
+  size_t skip = (64 - ((uintptr_t)dst & 63)) / sizeof(uint32_t);
+  dst += skip;
+  count -= skip;
+  for (; count >= 64; count -= 64, dst += 64) {
+    _mm512_store_si512(dst + 0, v);
+    _mm512_store_si512(dst + 16, v);
+    _mm512_store_si512(dst + 32, v);
+    _mm512_store_si512(dst + 48, v);
+  }
+  for (; count >= 16; count -= 16, dst += 16) {
+    _mm512_store_si512(dst, v);
+  }
+  // Masked tail instead of a scalar loop
+  if (count) {
+    _mm512_mask_storeu_epi32(dst, (__mmask16)((1u << count) - 1), v);
+  }
+}
+
+CPU_TARGET("avx512f") static void fill_stream_avx512(uint32_t *dst, uint32_t value, size_t count) {
+  count = fill_head(&dst, value, count, 64);
+  __m512i v = _mm512_set1_epi32((int)value);
+  for (; count >= 64; count -= 64, dst += 64) {
+    _mm512_stream_si512((__m512i *)(dst + 0), v);
+    _mm512_stream_si512((__m512i *)(dst + 16), v);
+    _mm512_stream_si512((__m512i *)(dst + 32), v);
+    _mm512_stream_si512((__m512i *)(dst + 48), v);
+  }
+  _mm_sfence();
+  fill_scalar(dst, value, count);
+}
+#endif
+
+typedef struct {
+  const char *name;
+  FillFn fill;
+  FillFn stream;
+} FillKernelEntry;
+
+static const FillKernelEntry kernels[FILL_KERNEL_COUNT] = {
+    [FILL_KERNEL_SCALAR] = {"scalar", fill_scalar, fill_scalar},
+#if CPU_X86
+    [FILL_KERNEL_SSE2] = {"sse2", fill_sse2, fill_stream_sse2},
+    [FILL_KERNEL_AVX2] = {"avx2", fill_avx2, fill_stream_avx2},
+    [FILL_KERNEL_AVX512] = {"avx512", fill_avx512, fill_stream_avx512},
+#else
+    [FILL_KERNEL_SSE2] = {"sse2", NULL, NULL},
+    [FILL_KERNEL_AVX2] = {"avx2", NULL, NULL},
+    [FILL_KERNEL_AVX512] = {"avx512", NULL, NULL},
+#endif
+};
+
+static _Atomic FillKernel active_kernel = FILL_KERNEL_SCALAR;
+static atomic_bool kernel_selected = false;
+static once_flag resolve_once = ONCE_FLAG_INIT;
+
+static bool kernel_supported(FillKernel kernel) {
+  const CpuFeatures *features = cpu_features();
+  switch (kernel) {
+  case FILL_KERNEL_SCALAR:
+    return true;
+  case FILL_KERNEL_SSE2:
+    return CPU_X86 && features->sse2;
+  case FILL_KERNEL_AVX2:
+    return CPU_X86 && features->avx2;
+  case FILL_KERNEL_AVX512:
+    return CPU_X86 && features->avx512f;
+  default:
+    return false;
+  }
+}
+
+static void resolve_widest(void) {
+  // A kernel forced before the first fill stays
+  if (atomic_load(&kernel_selected))
+    return;
+  for (int kernel = FILL_KERNEL_COUNT - 1; kernel >= 0; kernel--) {
+    if (fill_select_kernel((FillKernel)kernel))
+      return;
+  }
+}
+
+// Threads filling for the first time at once wait for the same resolve
+static void resolve(void) { call_once(&resolve_once, resolve_widest); }
+
+static void fill_resolve(uint32_t *dst, uint32_t value, size_t count) {
+  resolve();
+  fill_u32(dst, value, count);
+}
+
+static void fill_stream_resolve(uint32_t *dst, uint32_t value, size_t count) {
+  resolve();
+  fill_u32_stream(dst, value, count);
+}
+
+_Atomic(FillFn) fill_u32 = fill_resolve;
+_Atomic(FillFn) fill_u32_stream = fill_stream_resolve;
+
+bool fill_select_kernel(FillKernel kernel) {
+  if (kernel >= FILL_KERNEL_COUNT || !kernel_supported(kernel))
+    return false;
+
+  atomic_store(&active_kernel, kernel);
+  atomic_store(&fill_u32, kernels[kernel].fill);
+  atomic_store(&fill_u32_stream, kernels[kernel].stream);
+  atomic_store(&kernel_selected, true);
+  return true;
+}
+
+FillKernel fill_active_kernel(void) {
+  resolve();
+  return atomic_load(&active_kernel);
+}
+
+const char *fill_kernel_name(FillKernel kernel) { return kernel < FILL_KERNEL_COUNT ? kernels[kernel].name : "unknown"; }
@@ -0,0 +1,30 @@
+#ifndef FILL_H
+#define FILL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  FILL_KERNEL_SCALAR,
+  FILL_KERNEL_SSE2,
+  FILL_KERNEL_AVX2,
+  FILL_KERNEL_AVX512,
+  FILL_KERNEL_COUNT,
+} FillKernel;
+
+typedef void (*FillFn)(uint32_t *dst, uint32_t value, size_t count);
+
+// Resolved to the widest kernel the CPU supports on first call, from any thread.
+// fill_u32 keeps the written lines in cache, fill_u32_stream bypasses it with
+// non-temporal stores and is meant for buffers larger than the cache.
+extern _Atomic(FillFn) fill_u32;
+extern _Atomic(FillFn) fill_u32_stream;
+
+// Forces a kernel, returns false if the CPU does not support it
+bool fill_select_kernel(FillKernel kernel);
+FillKernel fill_active_kernel(void);
+const char *fill_kernel_name(FillKernel kernel);
+
+#endif // FILL_H
@@ -0,0 +1,194 @@
+#include "halfspace.h"
+#include "blend.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HALFSPACE_SSE2 1
+#else
+#define HALFSPACE_SSE2 0
+#endif
+
+#define BLOCK_SIZE 8
+
+// E(x, y) = a * x + b * y + c, in 28.4 units. A pixel is inside when E >= 0
+// at its center, the fill rule bias is folded into c.
+typedef struct {
+  int64_t a, b, c;
+} Edge;
+
+static void edge_setup(Edge *edge, Point from, Point to) {
+  edge->a = (int64_t)from.y - to.y;
+  edge->b = (int64_t)to.x - from.x;
+  edge->c = -(edge->a * from.x + edge->b * from.y);
+
+  // Top-left rule for y-down screens: left edges have the interior to the
+  // right (a > 0), top edges are horizontal with the interior below (b > 0).
+  bool top_left = edge->a > 0 || (edge->a == 0 && edge->b > 0);
+  if (!top_left) {
+    edge->c -= 1;
+  }
+}
+
+// Value at the center of pixel (px, py)
+static inline int64_t edge_at(const Edge *edge, int px, int py) {
+  return edge->a * ((int64_t)px * FIXED_ONE + FIXED_ONE / 2) + edge->b * ((int64_t)py * FIXED_ONE + FIXED_ONE / 2) + edge->c;
+}
+
+// An edge crossing an 8x8 block is at most 15 pixel steps of a and b away from zero
+// anywhere the SIMD path evaluates it, which fits in 32 bits below the limit
+static inline bool fits_simd(const Edge *edge) {
+  return edge->a > -HALFSPACE_SIMD_EDGE_LIMIT && edge->a < HALFSPACE_SIMD_EDGE_LIMIT && edge->b > -HALFSPACE_SIMD_EDGE_LIMIT &&
+         edge->b < HALFSPACE_SIMD_EDGE_LIMIT;
+}
+
+Rect halfspace_triangle_bounds(Point v0, Point v1, Point v2) {
+  int min_x = v0.x < v1.x ? (v0.x < v2.x ? v0.x : v2.x) : (v1.x < v2.x ? v1.x : v2.x);
+  int min_y = v0.y < v1.y ? (v0.y < v2.y ? v0.y : v2.y) : (v1.y < v2.y ? v1.y : v2.y);
+  int max_x = v0.x > v1.x ? (v0.x > v2.x ? v0.x : v2.x) : (v1.x > v2.x ? v1.x : v2.x);
+  int max_y = v0.y > v1.y ? (v0.y > v2.y ? v0.y : v2.y) : (v1.y > v2.y ? v1.y : v2.y);
+  return (Rect){min_x >> FIXED_SHIFT, min_y >> FIXED_SHIFT, (max_x >> FIXED_SHIFT) + 1, (max_y >> FIXED_SHIFT) + 1};
+}
+
+static inline bool inside_edges(const Edge *edges, int edge_count, int x, int y) {
+  for (int i = 0; i < edge_count; i++) {
+    if (edge_at(&edges[i], x, y) < 0)
+      return false;
+  }
+  return true;
+}
+
+// Per pixel test of a partially covered block, only for edges crossing it.
+// A triangle covers a single run per row, handed to span in one go.
+static void draw_partial_block_scalar(Surface *surface, Rect block, const Edge *edges, int edge_count, uint32_t color, FillFn span) {
+  for (int y = block.y0; y < block.y1; y++) {
+    int x = block.x0;
+    while (x < block.x1 && !inside_edges(edges, edge_count, x, y)) {
+      x++;
+    }
+    int run = x;
+    while (run < block.x1 && inside_edges(edges, edge_count, run, y)) {
+      run++;
+    }
+    if (run > x) {
+      span(rasterizer_pixel(surface, x, y), color, run - x);
+    }
+  }
+}
+
+#if HALFSPACE_SSE2
+// Edges crossing an 8x8 block stay within a few pixels of it, so their values
+// over the block fit in 32 bits when the edges are short enough, see fits_simd.
+static void draw_partial_block_sse2(Surface *surface, Rect block, const Edge *edges, int edge_count, uint32_t color) {
+  __m128i lo[3], hi[3], step_y[3];
+  for (int i = 0; i < edge_count; i++) {
+    int32_t e0 = (int32_t)edge_at(&edges[i], block.x0, block.y0);
+    int32_t sx = (int32_t)(edges[i].a * FIXED_ONE);
+    lo[i] = _mm_setr_epi32(e0, e0 + sx, e0 + 2 * sx, e0 + 3 * sx);
+    hi[i] = _mm_add_epi32(lo[i], _mm_set1_epi32(4 * sx));
+    step_y[i] = _mm_set1_epi32((int32_t)(edges[i].b * FIXED_ONE));
+  }
+
+  __m128i color_v = _mm_set1_epi32((int)color);
+  __m128i minus_one = _mm_set1_epi32(-1);
+  for (int y = block.y0; y < block.y1; y++) {
+    __m128i mask_lo = minus_one;
+    __m128i mask_hi = minus_one;
+    for (int i = 0; i < edge_count; i++) {
+      mask_lo = _mm_and_si128(mask_lo, _mm_cmpgt_epi32(lo[i], minus_one));
+      mask_hi = _mm_and_si128(mask_hi, _mm_cmpgt_epi32(hi[i], minus_one));
+      lo[i] = _mm_add_epi32(lo[i], step_y[i]);
+      hi[i] = _mm_add_epi32(hi[i], step_y[i]);
+    }
+
+    __m128i *dst = (__m128i *)rasterizer_pixel(surface, block.x0, y);
+    __m128i d0 = _mm_loadu_si128(dst);
+    __m128i d1 = _mm_loadu_si128(dst + 1);
+    d0 = _mm_or_si128(_mm_and_si128(mask_lo, color_v), _mm_andnot_si128(mask_lo, d0));
+    d1 = _mm_or_si128(_mm_and_si128(mask_hi, color_v), _mm_andnot_si128(mask_hi, d1));
+    _mm_storeu_si128(dst, d0);
+    _mm_storeu_si128(dst + 1, d1);
+  }
+}
+#endif
+
+void halfspace_draw_triangle(Surface *surface, Rect clip, Point v0, Point v1, Point v2, uint32_t color, BlendMode blend) {
+  int64_t area = ((int64_t)v1.x - v0.x) * ((int64_t)v2.y - v0.y) - ((int64_t)v1.y - v0.y) * ((int64_t)v2.x - v0.x);
+  if (area == 0)
+    return;
+
+  // Positive area keeps the interior on the positive side of every edge
+  if (area < 0) {
+    Point tmp = v1;
+    v1 = v2;
+    v2 = tmp;
+  }
+
+  Rect bounds = rect_intersect(halfspace_triangle_bounds(v0, v1, v2), clip);
+  if (rect_is_empty(bounds))
+    return;
+
+  Edge edges[3];
+  edge_setup(&edges[0], v0, v1);
+  edge_setup(&edges[1], v1, v2);
+  edge_setup(&edges[2], v2, v0);
+
+  FillFn span = blend_span(blend, surface->state.format);
+#if HALFSPACE_SSE2
+  // The masked stores only overwrite, blended partial blocks go through span
+  bool use_simd = blend == BLEND_MODE_REPLACE && fits_simd(&edges[0]) && fits_simd(&edges[1]) && fits_simd(&edges[2]);
+#endif
+
+  // The block grid is anchored at pixel zero, so the per-pixel decision
+  // depends on neither the clip rect nor the surface origin.
+  int bx0 = bounds.x0 & ~(BLOCK_SIZE - 1);
+  int by0 = bounds.y0 & ~(BLOCK_SIZE - 1);
+  for (int by = by0; by < bounds.y1; by += BLOCK_SIZE) {
+    for (int bx = bx0; bx < bounds.x1; bx += BLOCK_SIZE) {
+      Rect block = rect_intersect((Rect){bx, by, bx + BLOCK_SIZE, by + BLOCK_SIZE}, bounds);
+      if (rect_is_empty(block))
+        continue;
+
+      // Edge functions are linear, the block corners bound every pixel in it
+      Edge crossing[3];
+      int crossing_count = 0;
+      bool rejected = false;
+      for (int i = 0; i < 3 && !rejected; i++) {
+        int64_t c00 = edge_at(&edges[i], block.x0, block.y0);
+        int64_t c10 = edge_at(&edges[i], block.x1 - 1, block.y0);
+        int64_t c01 = edge_at(&edges[i], block.x0, block.y1 - 1);
+        int64_t c11 = edge_at(&edges[i], block.x1 - 1, block.y1 - 1);
+
+        bool all_outside = c00 < 0 && c10 < 0 && c01 < 0 && c11 < 0;
+        bool all_inside = c00 >= 0 && c10 >= 0 && c01 >= 0 && c11 >= 0;
+        if (all_outside) {
+          rejected = true;
+        } else if (!all_inside) {
+          crossing[crossing_count++] = edges[i];
+        }
+      }
+      if (rejected)
+        continue;
+
+      if (crossing_count == 0) {
+        // Trivial accept
+        int width = block.x1 - block.x0;
+        for (int y = block.y0; y < block.y1; y++) {
+          span(rasterizer_pixel(surface, block.x0, y), color, width);
+        }
+        continue;
+      }
+
+#if HALFSPACE_SSE2
+      // Narrow blocks at the clip border would read-modify-write pixels owned by neighbours
+      if (use_simd && block.x1 - block.x0 == BLOCK_SIZE) {
+        draw_partial_block_sse2(surface, block, crossing, crossing_count, color);
+        continue;
+      }
+#endif
+      draw_partial_block_scalar(surface, block, crossing, crossing_count, color, span);
+    }
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef HALFSPACE_H
+#define HALFSPACE_H
+
+#include "rasterizer.h"
+#include <math.h>
+
+// 28.4 fixed point: 4 bits of sub-pixel precision
+#define FIXED_SHIFT 4
+#define FIXED_ONE (1 << FIXED_SHIFT)
+
+// Triangles with an edge this long or longer, in 28.4 units along either axis,
+// take the 64-bit scalar path for partial blocks
+#define HALFSPACE_SIMD_EDGE_LIMIT (1 << 22)
+
+static inline int fixed_from_float(float v) { return (int)lrintf(v * FIXED_ONE); }
+static inline int fixed_from_double(double v) { return (int)llrint(v * FIXED_ONE); }
+
+// Pixels possibly covered by a triangle with 28.4 vertices
+Rect halfspace_triangle_bounds(Point v0, Point v1, Point v2);
+
+// Edge function rasterizer with a top-left fill rule: triangles sharing an
+// edge never both cover a pixel and never leave a gap. Works on 8x8 blocks,
+// fully covered blocks are filled, empty ones skipped, partial ones tested
+// per pixel.
+void halfspace_draw_triangle(Surface *surface, Rect clip, Point v0, Point v1, Point v2, uint32_t color, BlendMode blend);
+
+#endif // HALFSPACE_H
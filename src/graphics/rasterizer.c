@@ -1,14 +1,14 @@
 #include "rasterizer.h"
+#include "coverage.h"
+#include "fill.h"
+#include "halfspace.h"
 #include <math.h>
 #include <stdint.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static uint32_t *clear_buffer;
-static uint32_t clear_width = 0;
-static uint32_t clear_height = 0;
-static ColorF clear_colorf;
+// Below this size the surface stays in cache and regular stores win
+#define CLEAR_STREAM_MIN_BYTES (1 << 20)
 
 uint32_t pack_color(ColorF color) {
   uint8_t ri = (uint8_t)(color.r * 255.0f);
@@ -16,49 +16,128 @@ uint32_t pack_color(ColorF color) {
   uint8_t bi = (uint8_t)(color.b * 255.0f);
   uint8_t a = 255; // fully opaque
 
-  return (a << 24) | (ri << 16) | (gi << 8) | bi;
+  return ((uint32_t)a << 24) | (ri << 16) | (gi << 8) | bi;
 }
 
+uint32_t pack_color_alpha(ColorF color) {
+  uint8_t a = (uint8_t)(color.a * 255.0f);
+  return (pack_color(color) & 0x00ffffff) | ((uint32_t)a << 24);
+}
+
+uint32_t pack_color_premultiplied(ColorF color) { return blend_premultiply(pack_color_alpha(color)); }
+
 void set_pixel(Surface *surface, uint32_t x, uint32_t y, uint32_t color) {
 if (x < surface->width && y < surface->height) {
     surface->buffer[y * surface->width + x] = color;
   }
 }
 
-void rasterizer_set_clear_color(Surface *surface, ColorF color) {
-  if (clear_buffer && (surface->width != clear_width || surface->height != clear_height)) {
-    free(clear_buffer);
-    clear_buffer = (void *)0; // Set pointer to null
-  }
+// aligned_alloc wants a multiple of the alignment
+static uint32_t *alloc_plane(uint32_t width, uint32_t height) {
+  size_t bytes = (size_t)width * height * sizeof(uint32_t);
+  bytes = (bytes + RASTERIZER_SURFACE_ALIGN - 1) & ~(size_t)(RASTERIZER_SURFACE_ALIGN - 1);
+  return aligned_alloc(RASTERIZER_SURFACE_ALIGN, bytes ? bytes : RASTERIZER_SURFACE_ALIGN);
+}
 
-  if (!clear_buffer) {
-    clear_buffer = malloc(sizeof(uint32_t) * surface->width * surface->height);
-    clear_width = surface->width;
-    clear_height = surface->height;
+void rasterizer_surface_resize(Surface *surface, uint32_t width, uint32_t height) {
+  if (surface->buffer && surface->width == width && surface->height == height)
+    return;
+  free(surface->buffer);
+  surface->width = width;
+  surface->height = height;
+  surface->buffer = alloc_plane(width, height);
+  if (surface->ids) {
+    free(surface->ids);
+    surface->ids = alloc_plane(width, height);
   }
+}
 
-  // generate the buffer
-  printf("Recreating clear color buffer\n");
-  clear_colorf = color;
-  uint32_t color_packed = pack_color(color);
-  for (int y = 0; y < surface->height; y++) {
-    for (int x = 0; x < surface->width; x++) {
-      clear_buffer[y * surface->width + x] = color_packed;
-    }
-  }
+void rasterizer_surface_free(Surface *surface) {
+  free(surface->buffer);
+  free(surface->ids);
+  surface->buffer = NULL;
+  surface->ids = NULL;
+  surface->width = surface->height = 0;
+}
+
+void rasterizer_surface_set_ids(Surface *surface, bool enabled) {
+  if (enabled == (surface->ids != NULL))
+    return;
+  free(surface->ids);
+  surface->ids = enabled ? alloc_plane(surface->width, surface->height) : NULL;
+}
+
+void rasterizer_set_mode(Surface *surface, RasterMode mode) { surface->state.mode = mode; }
+
+RasterMode rasterizer_get_mode(const Surface *surface) { return surface->state.mode; }
+
+void rasterizer_set_clear_color(Surface *surface, ColorF color) { surface->state.clear_color = color; }
+
+void rasterizer_set_format(Surface *surface, PixelFormat format) { surface->state.format = format; }
+
+static uint32_t clear_value(const Surface *surface) {
+  ColorF color = surface->state.clear_color;
+  return surface->state.format == PIXEL_FORMAT_ARGB8888 ? pack_color_premultiplied(color) : pack_color(color);
 }
 
 void rasterizer_clear_surface(Surface *surface) {
-  // If size change update clear buffer with the prev color
-  if (surface->width != clear_width || surface->height != clear_height) {
-    rasterizer_set_clear_color(surface, clear_colorf);
+  size_t count = (size_t)surface->width * surface->height;
+  uint32_t color_packed = clear_value(surface);
+
+  if (count * sizeof(uint32_t) >= CLEAR_STREAM_MIN_BYTES) {
+    fill_u32_stream(surface->buffer, color_packed, count);
+  } else {
+    fill_u32(surface->buffer, color_packed, count);
+  }
+  if (surface->ids) {
+    memset(surface->ids, 0, count * sizeof(uint32_t));
   }
-  memcpy(surface->buffer, clear_buffer, sizeof(uint32_t) * surface->width * surface->height);
 }
 
-void draw_span(Surface *surface, int y, int x0, int x1, uint32_t color) {
+void rasterizer_clear_rect(Surface *surface, Rect rect) {
+  rect = rect_intersect(rect, rasterizer_surface_rect(surface));
+  if (rect_is_empty(rect))
+    return;
+
+  uint32_t color_packed = clear_value(surface);
+  for (int y = rect.y0; y < rect.y1; y++) {
+    fill_u32(rasterizer_pixel(surface, rect.x0, y), color_packed, rect.x1 - rect.x0);
+  }
+  Surface plane = {.width = surface->width, .height = surface->height, .buffer = surface->ids, .origin = surface->origin};
+  for (int y = rect.y0; y < rect.y1 && surface->ids; y++) {
+    memset(rasterizer_pixel(&plane, rect.x0, y), 0, (size_t)(rect.x1 - rect.x0) * sizeof(uint32_t));
+  }
+}
+
+Rect rasterizer_surface_rect(const Surface *surface) {
+  Point o = surface->origin;
+  return (Rect){o.x, o.y, o.x + (int)surface->width, o.y + (int)surface->height};
+}
+
+Rect rect_intersect(Rect a, Rect b) {
+  Rect r = {
+      .x0 = a.x0 > b.x0 ? a.x0 : b.x0,
+      .y0 = a.y0 > b.y0 ? a.y0 : b.y0,
+      .x1 = a.x1 < b.x1 ? a.x1 : b.x1,
+      .y1 = a.y1 < b.y1 ? a.y1 : b.y1,
+  };
+  return r;
+}
+
+Rect rect_union(Rect a, Rect b) {
+  Rect r = {
+      .x0 = a.x0 < b.x0 ? a.x0 : b.x0,
+      .y0 = a.y0 < b.y0 ? a.y0 : b.y0,
+      .x1 = a.x1 > b.x1 ? a.x1 : b.x1,
+      .y1 = a.y1 > b.y1 ? a.y1 : b.y1,
+  };
+  return r;
+}
+
+// Inclusive span [x0, x1] on row y, clipped against clip and written by span
+static void draw_span_clipped(Surface *surface, Rect clip, int y, int x0, int x1, uint32_t color, FillFn span) {
   // Clip Y coordinate first
-  if (y < 0 || y >= surface->height)
+  if (y < clip.y0 || y >= clip.y1)
     return;
 
   // Ensure x0 <= x1
@@ -69,27 +148,43 @@ void draw_span(Surface *surface, int y, int x0, int x1, uint32_t color) {
   }
 
   // Fully out-of-bounds check (left and right)
-  if (x1 < 0 || x0 >= surface->width)
+  if (x1 < clip.x0 || x0 >= clip.x1)
     return;
 
   // Clip X coordinates correctly
-  int start_x = (x0 < 0) ? 0 : x0;
-  int end_x = (x1 >= surface->width) ? surface->width - 1 : x1;
+  int start_x = (x0 < clip.x0) ? clip.x0 : x0;
+  int end_x = (x1 >= clip.x1) ? clip.x1 - 1 : x1;
 
   // Ensure valid span after clipping
   if (start_x > end_x)
     return;
 
-  // Optimized drawing using pointer arithmetic
-  uint32_t *row = &surface->buffer[y * surface->width + start_x];
-  int count = end_x - start_x + 1;
+  span(rasterizer_pixel(surface, start_x, y), color, end_x - start_x + 1);
+}
 
-  while (count--) {
-    *row++ = color;
-  }
+void draw_span(Surface *surface, int y, int x0, int x1, uint32_t color) {
+  draw_span_clipped(surface, rasterizer_surface_rect(surface), y, x0, x1, color, fill_u32);
 }
 
-void draw_filled_triangle(Surface *surface, Point p0, Point p1, Point p2, uint32_t color) {
+static bool same_edge(Point a, Point b, Point c, Point d) {
+  return (a.x == c.x && a.y == c.y && b.x == d.x && b.y == d.y) || (a.x == d.x && a.y == d.y && b.x == c.x && b.y == c.y);
+}
+
+// Inclusive span between x_shared and x_other without the pixel at x_shared, false when nothing is left
+static bool exclude_shared(int *x_shared, int x_other) {
+  if (*x_shared == x_other)
+    return false;
+  *x_shared += *x_shared < x_other ? 1 : -1;
+  return true;
+}
+
+// Span ends are evaluated per row from the top vertex instead of being
+// accumulated, so a row gets the same span whichever clip rect it is drawn with.
+// An edge is rounded the same way by both triangles sharing it, with skip_p0p1 the
+// spans leave its pixel out so a blended pair touches every pixel once.
+static void draw_filled_triangle_clipped(Surface *surface, Rect clip, Point p0, Point p1, Point p2, uint32_t color, FillFn span,
+                                         bool skip_p0p1) {
+  Point shared0 = p0, shared1 = p1;
   // Sort points by Y-coordinate (lowest to highest)
   if (p1.y < p0.y) {
     Point tmp = p0;
@@ -107,37 +202,100 @@ void draw_filled_triangle(Surface *surface, Point p0, Point p1, Point p2, uint32
     p2 = tmp;
   }
 
-  // Compute X slopes (avoiding divide by zero)
-  float dx01 = (p1.y != p0.y) ? (float)(p1.x - p0.x) / (p1.y - p0.y) : 0;
-  float dx02 = (p2.y != p0.y) ? (float)(p2.x - p0.x) / (p2.y - p0.y) : 0;
-  float dx12 = (p2.y != p1.y) ? (float)(p2.x - p1.x) / (p2.y - p1.y) : 0;
+  // Compute X slopes (avoiding divide by zero). Double, vertices of trimmed lines
+  // are millions of pixels away and float would round the spans a pixel off.
+  double dx01 = (p1.y != p0.y) ? (double)(p1.x - p0.x) / (p1.y - p0.y) : 0;
+  double dx02 = (p2.y != p0.y) ? (double)(p2.x - p0.x) / (p2.y - p0.y) : 0;
+  double dx12 = (p2.y != p1.y) ? (double)(p2.x - p1.x) / (p2.y - p1.y) : 0;
 
-  // Left-Right ordering for better rasterization
-  float xa = p0.x, xb = p0.x;
-  for (int y = p0.y; y < p1.y; y++) {
-    draw_span(surface, y, (int)roundf(xa), (int)roundf(xb), color);
-    xa += dx01;
-    xb += dx02;
+  // Which of the short edges (xa) or the long one (xb) is shared, per half
+  bool skip_long = skip_p0p1 && same_edge(p0, p2, shared0, shared1);
+  bool skip_01 = skip_p0p1 && same_edge(p0, p1, shared0, shared1);
+  bool skip_12 = skip_p0p1 && same_edge(p1, p2, shared0, shared1);
+
+  int y_start = p0.y > clip.y0 ? p0.y : clip.y0;
+  int y_end = p1.y < clip.y1 ? p1.y : clip.y1;
+  for (int y = y_start; y < y_end; y++) {
+    int xa = (int)round(p0.x + dx01 * (y - p0.y));
+    int xb = (int)round(p0.x + dx02 * (y - p0.y));
+    if ((skip_01 && !exclude_shared(&xa, xb)) || (skip_long && !exclude_shared(&xb, xa)))
+      continue;
+    draw_span_clipped(surface, clip, y, xa, xb, color, span);
   }
 
-  xa = p1.x;
-  for (int y = p1.y; y < p2.y; y++) {
-    draw_span(surface, y, (int)roundf(xa), (int)roundf(xb), color);
-    xa += dx12;
-    xb += dx02;
+  y_start = p1.y > clip.y0 ? p1.y : clip.y0;
+  y_end = p2.y < clip.y1 ? p2.y : clip.y1;
+  for (int y = y_start; y < y_end; y++) {
+    int xa = (int)round(p1.x + dx12 * (y - p1.y));
+    int xb = (int)round(p0.x + dx02 * (y - p0.y));
+    if ((skip_12 && !exclude_shared(&xa, xb)) || (skip_long && !exclude_shared(&xb, xa)))
+      continue;
+    draw_span_clipped(surface, clip, y, xa, xb, color, span);
   }
 }
 
-void rasterizer_draw_thick_line(Surface *surface, Point p0, Point p1, int thickness, ColorF color) {
+void draw_filled_triangle(Surface *surface, Point p0, Point p1, Point p2, uint32_t color) {
+  draw_filled_triangle_clipped(surface, rasterizer_surface_rect(surface), p0, p1, p2, color, fill_u32, false);
+}
+
+// Lines are trimmed to this far from pixel zero, the limit stroked paths have too.
+// The window doesn't depend on the surface, so a line is set up the same for every
+// tile it crosses and the tiles match a single draw of the whole area.
+// The setups work in double from here on, float has half a pixel of precision
+// at the ends of the window and a visible part would inherit it.
+#define TRIM_LIMIT 4194304.0
+
+// Liang-Barsky: clips the segment p0-p1 to rect, false if nothing is left
+static int clip_segment(double rect_x0, double rect_y0, double rect_x1, double rect_y1, double p0[2], double p1[2]) {
+  double dx = p1[0] - p0[0];
+  double dy = p1[1] - p0[1];
+  double p[4] = {-dx, dx, -dy, dy};
+  double q[4] = {p0[0] - rect_x0, rect_x1 - p0[0], p0[1] - rect_y0, rect_y1 - p0[1]};
+  double t0 = 0.0, t1 = 1.0;
+
+  for (int i = 0; i < 4; i++) {
+    if (p[i] == 0.0) {
+      if (q[i] < 0.0)
+        return 0;
+      continue;
+    }
+    double t = q[i] / p[i];
+    if (p[i] < 0.0) {
+      t0 = t > t0 ? t : t0;
+    } else {
+      t1 = t < t1 ? t : t1;
+    }
+  }
+  if (t0 > t1)
+    return 0;
+
+  double x0 = p0[0], y0 = p0[1];
+  p0[0] = x0 + t0 * dx;
+  p0[1] = y0 + t0 * dy;
+  p1[0] = x0 + t1 * dx;
+  p1[1] = y0 + t1 * dy;
+  return 1;
+}
+
+static int trim_line(double p0[2], double p1[2]) { return clip_segment(-TRIM_LIMIT, -TRIM_LIMIT, TRIM_LIMIT, TRIM_LIMIT, p0, p1); }
+
+// Clamped to the 24 integer bits of AaPolygon, trimmed lines stay well inside them
+static int32_t aa_coord(double v) {
+  double limit = 2.0 * TRIM_LIMIT;
+  v = fmin(fmax(v, -limit), limit - 1.0);
+  return (int32_t)llrint(v * AA_POLYGON_ONE);
+}
+
+int rasterizer_setup_thick_line(const Surface *surface, Point p0, Point p1, int thickness, uint32_t color, RasterPrim out[2]) {
   if (surface->width < 1)
-    return;
+    return 0;
 
   // Compute direction vector
   float dx = p1.x - p0.x;
   float dy = p1.y - p0.y;
   float length = sqrtf(dx * dx + dy * dy);
   if (length == 0)
-    return;
+    return 0;
 
   // Normalize and find perpendicular
   float nx = -dy / length;
@@ -148,28 +306,315 @@ void rasterizer_draw_thick_line(Surface *surface, Point p0, Point p1, int thickn
   nx *= half_w;
   ny *= half_w;
 
+  // Trim the centerline like the fixed point setup, clamped corners bent the line at the edge
+  double a[2] = {p0.x, p0.y};
+  double b[2] = {p1.x, p1.y};
+  if (!trim_line(a, b))
+    return 0;
+
   // Compute rectangle corners
-  Point v0 = {roundf(p0.x + nx), roundf(p0.y + ny)};
-  Point v1 = {roundf(p0.x - nx), roundf(p0.y - ny)};
-  Point v2 = {roundf(p1.x + nx), roundf(p1.y + ny)};
-  Point v3 = {roundf(p1.x - nx), roundf(p1.y - ny)};
+  Point v0 = {(int)round(a[0] + nx), (int)round(a[1] + ny)};
+  Point v1 = {(int)round(a[0] - nx), (int)round(a[1] - ny)};
+  Point v2 = {(int)round(b[0] + nx), (int)round(b[1] + ny)};
+  Point v3 = {(int)round(b[0] - nx), (int)round(b[1] - ny)};
+
+  // Both triangles round the v1-v2 diagonal alike, the second one leaves its pixels to the first
+  out[0] = (RasterPrim){.type = RASTER_PRIM_TRIANGLE, .color = color, .v = {v0, v1, v2}};
+  out[1] = (RasterPrim){.type = RASTER_PRIM_TRIANGLE_ADJACENT, .color = color, .v = {v1, v2, v3}};
+  return 2;
+}
 
-  // Clamp corners **AFTER computing them**
-  v0.x = (v0.x < 0) ? 0 : (v0.x >= surface->width ? surface->width - 1 : v0.x);
-  v0.y = (v0.y < 0) ? 0 : (v0.y >= surface->height ? surface->height - 1 : v0.y);
+int rasterizer_setup_thick_line_fixed(const Surface *surface, vec2 p0, vec2 p1, float thickness, uint32_t color, RasterPrim out[2]) {
+  if (surface->width < 1)
+    return 0;
 
-  v1.x = (v1.x < 0) ? 0 : (v1.x >= surface->width ? surface->width - 1 : v1.x);
-  v1.y = (v1.y < 0) ? 0 : (v1.y >= surface->height ? surface->height - 1 : v1.y);
+  float dx = p1[0] - p0[0];
+  float dy = p1[1] - p0[1];
+  float length = sqrtf(dx * dx + dy * dy);
+  if (length == 0)
+    return 0;
 
-  v2.x = (v2.x < 0) ? 0 : (v2.x >= surface->width ? surface->width - 1 : v2.x);
-  v2.y = (v2.y < 0) ? 0 : (v2.y >= surface->height ? surface->height - 1 : v2.y);
+  float half_w = thickness * 0.5f;
+  float nx = -dy / length * half_w;
+  float ny = dx / length * half_w;
 
-  v3.x = (v3.x < 0) ? 0 : (v3.x >= surface->width ? surface->width - 1 : v3.x);
-  v3.y = (v3.y < 0) ? 0 : (v3.y >= surface->height ? surface->height - 1 : v3.y);
+  // Trim the centerline instead of clamping corners, keeps the shape exact and
+  // the coordinates in range.
+  double a[2] = {p0[0], p0[1]};
+  double b[2] = {p1[0], p1[1]};
+  if (!trim_line(a, b))
+    return 0;
 
-  uint32_t color_packed = pack_color(color);
+  Point v0 = {fixed_from_double(a[0] + nx), fixed_from_double(a[1] + ny)};
+  Point v1 = {fixed_from_double(a[0] - nx), fixed_from_double(a[1] - ny)};
+  Point v2 = {fixed_from_double(b[0] + nx), fixed_from_double(b[1] + ny)};
+  Point v3 = {fixed_from_double(b[0] - nx), fixed_from_double(b[1] - ny)};
 
-  // Ensure correct triangle order
-  draw_filled_triangle(surface, v0, v1, v2, color_packed);
-  draw_filled_triangle(surface, v1, v2, v3, color_packed);
+  // Both triangles share the v1-v2 diagonal, the fill rule gives each pixel on it to one of them
+  out[0] = (RasterPrim){.type = RASTER_PRIM_TRIANGLE_FIXED, .color = color, .v = {v0, v1, v2}};
+  out[1] = (RasterPrim){.type = RASTER_PRIM_TRIANGLE_FIXED, .color = color, .v = {v1, v2, v3}};
+  return 2;
+}
+
+int rasterizer_setup_thick_line_aa(vec2 p0, vec2 p1, float thickness, uint32_t color, RasterPrim *out) {
+  float dx = p1[0] - p0[0];
+  float dy = p1[1] - p0[1];
+  float length = sqrtf(dx * dx + dy * dy);
+  if (length == 0)
+    return 0;
+
+  float half_w = thickness * 0.5f;
+  float nx = -dy / length * half_w;
+  float ny = dx / length * half_w;
+
+  double a[2] = {p0[0], p0[1]};
+  double b[2] = {p1[0], p1[1]};
+  if (!trim_line(a, b))
+    return 0;
+
+  // One quad, two triangles would each blend the shared diagonal
+  out->type = RASTER_PRIM_AA_POLYGON;
+  out->blend = BLEND_MODE_REPLACE;
+  out->color = color;
+  out->id = RASTERIZER_NO_ID;
+  out->polygon = (AaPolygon){
+      .x = {aa_coord(a[0] + nx), aa_coord(b[0] + nx), aa_coord(b[0] - nx), aa_coord(a[0] - nx)},
+      .y = {aa_coord(a[1] + ny), aa_coord(b[1] + ny), aa_coord(b[1] - ny), aa_coord(a[1] - ny)},
+      .count = 4,
+  };
+  return 1;
+}
+
+int rasterizer_setup_triangle_aa(vec2 p0, vec2 p1, vec2 p2, uint32_t color, RasterPrim *out) {
+  out->type = RASTER_PRIM_AA_POLYGON;
+  out->blend = BLEND_MODE_REPLACE;
+  out->color = color;
+  out->id = RASTERIZER_NO_ID;
+  out->polygon = (AaPolygon){
+      .x = {aa_coord(p0[0]), aa_coord(p1[0]), aa_coord(p2[0])},
+      .y = {aa_coord(p0[1]), aa_coord(p1[1]), aa_coord(p2[1])},
+      .count = 3,
+  };
+  return 1;
+}
+
+int rasterizer_setup_thin_line(vec2 p0, vec2 p1, float thickness, uint32_t color, RasterPrim *out) {
+  // Not clipped to the surface, that moved the first step and with it the rounding
+  // of every step after it. Steps outside the clip are skipped when drawing.
+  double a[2] = {p0[0], p0[1]};
+  double b[2] = {p1[0], p1[1]};
+  if (!trim_line(a, b))
+    return 0;
+
+  double dx = b[0] - a[0];
+  double dy = b[1] - a[1];
+  int x_major = fabs(dx) >= fabs(dy);
+
+  // Walk the major axis from the lower end
+  double major0 = x_major ? a[0] : a[1];
+  double major1 = x_major ? b[0] : b[1];
+  double minor0 = x_major ? a[1] : a[0];
+  double d_major = x_major ? dx : dy;
+  double d_minor = x_major ? dy : dx;
+  if (major1 < major0) {
+    major0 = major1;
+    minor0 += d_minor;
+    d_major = -d_major;
+    d_minor = -d_minor;
+  }
+  double slope = d_major != 0.0 ? d_minor / d_major : 0.0;
+
+  int first = (int)floor(major0);
+  int last = (int)floor(major0 + fabs(d_major));
+
+  // Sample the minor axis at the center of the first step
+  double minor_first = minor0 + slope * (first + 0.5 - major0);
+
+  out->type = RASTER_PRIM_THIN_LINE;
+  out->blend = BLEND_MODE_REPLACE;
+  out->color = color;
+  out->id = RASTERIZER_NO_ID;
+  out->line = (ThinLine){
+      .first = first,
+      .last = last,
+      .minor = (int64_t)llrint(ldexp(minor_first, 32)),
+      .step = (int64_t)llrint(ldexp(slope, 32)),
+      .run = thickness < 1.5f ? 1 : 2,
+      .x_major = x_major,
+  };
+  return 1;
+}
+
+// Pixel coordinate of the first pixel of the run at major step i
+static inline int thin_line_minor(const ThinLine *line, int i) {
+  int64_t minor = line->minor + line->step * (i - line->first);
+  return (int)(minor >> 32) - (line->run - 1) / 2;
+}
+
+static void draw_thin_line(Surface *surface, Rect clip, const ThinLine *line, uint32_t color, BlendMode blend) {
+  FillFn span = blend_span(blend, surface->state.format);
+  int major_lo = line->x_major ? clip.x0 : clip.y0;
+  int major_hi = line->x_major ? clip.x1 : clip.y1;
+  int minor_lo = line->x_major ? clip.y0 : clip.x0;
+  int minor_hi = line->x_major ? clip.y1 : clip.x1;
+
+  int first = line->first > major_lo ? line->first : major_lo;
+  int last = line->last < major_hi - 1 ? line->last : major_hi - 1;
+
+  for (int i = first; i <= last; i++) {
+    int m0 = thin_line_minor(line, i);
+    int m1 = m0 + line->run;
+    m0 = m0 > minor_lo ? m0 : minor_lo;
+    m1 = m1 < minor_hi ? m1 : minor_hi;
+    if (m0 >= m1)
+      continue;
+
+    if (line->x_major) {
+      uint32_t *pixel = rasterizer_pixel(surface, i, m0);
+      for (int m = m0; m < m1; m++, pixel += surface->width) {
+        if (blend == BLEND_MODE_REPLACE) {
+          *pixel = color;
+        } else {
+          span(pixel, color, 1);
+        }
+      }
+    } else {
+      span(rasterizer_pixel(surface, m0, i), color, m1 - m0);
+    }
+  }
+}
+
+int rasterizer_setup_line(const Surface *surface, vec2 p0, vec2 p1, float thickness, uint32_t color, RasterPrim out[2]) {
+  if (surface->state.mode == RASTER_MODE_ANALYTIC_AA) {
+    return rasterizer_setup_thick_line_aa(p0, p1, thickness, color, out);
+  }
+
+  // The aliased modes ignore alpha
+  color |= 0xff000000;
+  if (thickness < RASTERIZER_THIN_LINE_THRESHOLD) {
+    return rasterizer_setup_thin_line(p0, p1, thickness, color, out);
+  }
+
+  if (surface->state.mode == RASTER_MODE_HALFSPACE) {
+    return rasterizer_setup_thick_line_fixed(surface, p0, p1, thickness, color, out);
+  }
+
+  Point a = {.x = p0[0], .y = p0[1]};
+  Point b = {.x = p1[0], .y = p1[1]};
+  return rasterizer_setup_thick_line(surface, a, b, thickness, color, out);
+}
+
+Rect rasterizer_prim_bounds(const RasterPrim *prim) {
+  if (prim->type == RASTER_PRIM_THIN_LINE) {
+    const ThinLine *line = &prim->line;
+    int m0 = thin_line_minor(line, line->first);
+    int m1 = thin_line_minor(line, line->last);
+    int lo = m0 < m1 ? m0 : m1;
+    int hi = (m0 > m1 ? m0 : m1) + line->run;
+    return line->x_major ? (Rect){line->first, lo, line->last + 1, hi} : (Rect){lo, line->first, hi, line->last + 1};
+  }
+  if (prim->type == RASTER_PRIM_TRIANGLE_FIXED) {
+    return halfspace_triangle_bounds(prim->v[0], prim->v[1], prim->v[2]);
+  }
+  if (prim->type == RASTER_PRIM_AA_POLYGON) {
+    return coverage_polygon_bounds(&prim->polygon);
+  }
+
+  Rect r = {prim->v[0].x, prim->v[0].y, prim->v[0].x, prim->v[0].y};
+  for (int i = 1; i < 3; i++) {
+    r.x0 = prim->v[i].x < r.x0 ? prim->v[i].x : r.x0;
+    r.y0 = prim->v[i].y < r.y0 ? prim->v[i].y : r.y0;
+    r.x1 = prim->v[i].x > r.x1 ? prim->v[i].x : r.x1;
+    r.y1 = prim->v[i].y > r.y1 ? prim->v[i].y : r.y1;
+  }
+  // Spans are inclusive on x, the bottom row is exclusive
+  r.x1 += 1;
+  return r;
+}
+
+void rasterizer_blend_prims(RasterPrim *prims, int count, BlendMode blend, uint32_t color) {
+  for (int i = 0; i < count; i++) {
+    prims[i].blend = blend;
+    prims[i].color = color;
+  }
+}
+
+// Draws the prim's id into the id plane through the aliased paths, so it lands on the
+// pixels the color did. AA polygons take the half-space rule, a pixel goes to the
+// polygon covering its center.
+static void draw_prim_id(const Surface *surface, Rect clip, const RasterPrim *prim) {
+  Surface plane = {.width = surface->width, .height = surface->height, .buffer = surface->ids, .origin = surface->origin};
+  switch (prim->type) {
+  case RASTER_PRIM_TRIANGLE:
+  case RASTER_PRIM_TRIANGLE_ADJACENT:
+    draw_filled_triangle_clipped(&plane, clip, prim->v[0], prim->v[1], prim->v[2], prim->id, fill_u32, prim->type == RASTER_PRIM_TRIANGLE_ADJACENT);
+    break;
+  case RASTER_PRIM_TRIANGLE_FIXED:
+    halfspace_draw_triangle(&plane, clip, prim->v[0], prim->v[1], prim->v[2], prim->id, BLEND_MODE_REPLACE);
+    break;
+  case RASTER_PRIM_THIN_LINE:
+    draw_thin_line(&plane, clip, &prim->line, prim->id, BLEND_MODE_REPLACE);
+    break;
+  case RASTER_PRIM_AA_POLYGON: {
+    const AaPolygon *polygon = &prim->polygon;
+    Point first = {fixed_from_double(aa_polygon_coord(polygon->x[0])), fixed_from_double(aa_polygon_coord(polygon->y[0]))};
+    for (int i = 1; i + 1 < polygon->count; i++) {
+      Point b = {fixed_from_double(aa_polygon_coord(polygon->x[i])), fixed_from_double(aa_polygon_coord(polygon->y[i]))};
+      Point c = {fixed_from_double(aa_polygon_coord(polygon->x[i + 1])), fixed_from_double(aa_polygon_coord(polygon->y[i + 1]))};
+      halfspace_draw_triangle(&plane, clip, first, b, c, prim->id, BLEND_MODE_REPLACE);
+    }
+    break;
+  }
+  }
+}
+
+void rasterizer_draw_prim(Surface *surface, Rect clip, const RasterPrim *prim) {
+  switch (prim->type) {
+  case RASTER_PRIM_TRIANGLE:
+  case RASTER_PRIM_TRIANGLE_ADJACENT:
+    draw_filled_triangle_clipped(surface, clip, prim->v[0], prim->v[1], prim->v[2], prim->color, blend_span(prim->blend, surface->state.format),
+                                 prim->type == RASTER_PRIM_TRIANGLE_ADJACENT);
+    break;
+  case RASTER_PRIM_TRIANGLE_FIXED:
+    halfspace_draw_triangle(surface, clip, prim->v[0], prim->v[1], prim->v[2], prim->color, prim->blend);
+    break;
+  case RASTER_PRIM_THIN_LINE:
+    draw_thin_line(surface, clip, &prim->line, prim->color, prim->blend);
+    break;
+  case RASTER_PRIM_AA_POLYGON:
+    coverage_draw_polygon(surface, clip, &prim->polygon, prim->color, prim->blend);
+    break;
+  }
+  if (surface->ids) {
+    draw_prim_id(surface, clip, prim);
+  }
+}
+
+void rasterizer_draw_prims(Surface *surface, Rect clip, const RasterPrim *prims, int count) {
+  for (int i = 0; i < count; i++) {
+    Rect r = rect_intersect(clip, rasterizer_prim_bounds(&prims[i]));
+    if (!rect_is_empty(r)) {
+      rasterizer_draw_prim(surface, r, &prims[i]);
+    }
+  }
+}
+
+void rasterizer_draw_thick_line(Surface *surface, Point p0, Point p1, int thickness, ColorF color) {
+  RasterPrim prims[2];
+  int count = rasterizer_setup_thick_line(surface, p0, p1, thickness, pack_color(color), prims);
+
+  Rect clip = rasterizer_surface_rect(surface);
+  for (int i = 0; i < count; i++) {
+    rasterizer_draw_prim(surface, clip, &prims[i]);
+  }
+}
+
+void rasterizer_draw_line(Surface *surface, vec2 p0, vec2 p1, float thickness, ColorF color) {
+  RasterPrim prims[2];
+  int count = rasterizer_setup_line(surface, p0, p1, thickness, pack_color(color), prims);
+
+  Rect clip = rasterizer_surface_rect(surface);
+  for (int i = 0; i < count; i++) {
+    rasterizer_draw_prim(surface, clip, &prims[i]);
+  }
 }
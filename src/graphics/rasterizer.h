@@ -1,19 +1,21 @@
 #pragma once
 
 #include "../utils.h"
+#include "blend.h"
 #include <cglm/types.h>
+#include <stdbool.h>
 #include <stdint.h>
 
-typedef struct {
-  uint32_t width;
-  uint32_t height;
-  uint32_t *buffer;
-} Surface;
-
 typedef struct {
   int x, y;
 } Point;
 
+
+// Half-open pixel rectangle [x0, x1) x [y0, y1)
+typedef struct {
+  int x0, y0, x1, y1;
+} Rect;
+
 typedef struct {
   float r;
   float g;
@@ -21,7 +23,143 @@ typedef struct {
   float a;
 } ColorF ;
 
+typedef enum {
+  RASTER_MODE_SCANLINE, // Scanline walker on integer vertices
+  RASTER_MODE_HALFSPACE, // Edge functions on 28.4 vertices, top-left fill rule
+  RASTER_MODE_ANALYTIC_AA, // Per-pixel edge coverage, blends with the color's alpha
+} RasterMode;
+
+// Rasterizer settings of one render target. Nothing is shared between surfaces,
+// so several of them can be drawn at once from different threads.
+typedef struct {
+  RasterMode mode;
+  ColorF clear_color;
+  PixelFormat format;
+} RasterState;
+
+// Buffers from rasterizer_surface_resize are aligned to RASTERIZER_SURFACE_ALIGN
+#define RASTERIZER_SURFACE_ALIGN 64
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint32_t *buffer;
+  // Pixel coordinates of buffer[0]. Prims, clips and rects are in these coordinates,
+  // so a surface can hold one tile of a larger image drawn with the same prims.
+  Point origin;
+  RasterState state; // Zero is scanline, opaque black, XRGB
+  // Optional, the id of the prim drawn last at each pixel or RASTERIZER_NO_ID.
+  // Same size and alignment as buffer, see rasterizer_surface_set_ids.
+  uint32_t *ids;
+} Surface;
+
+#define RASTERIZER_NO_ID 0
+
+typedef enum {
+  RASTER_PRIM_TRIANGLE,
+  RASTER_PRIM_TRIANGLE_ADJACENT, // Leaves the pixels of its v[0]-v[1] edge to the triangle it shares it with
+  RASTER_PRIM_TRIANGLE_FIXED, // Vertices in 28.4 fixed point
+  RASTER_PRIM_THIN_LINE,
+  RASTER_PRIM_AA_POLYGON,
+} RasterPrimType;
+
+// Lines thinner than this skip triangle setup and are drawn with a DDA
+#define RASTERIZER_THIN_LINE_THRESHOLD 2.0f
+
+// One run of `run` pixels across the minor axis per major axis step.
+// The minor coordinate of step i is minor + step * (i - first), in 32.32, which
+// stays well under a pixel over the longest trimmed line.
+typedef struct {
+  int first, last; // Inclusive major axis range
+  int64_t minor;
+  int64_t step;
+  int run;
+  int x_major;
+} ThinLine;
+
+#define AA_POLYGON_MAX_VERTICES 4
+
+// 24.8 fixed point, exact across the window lines are trimmed to where float
+// would be half a pixel off
+#define AA_POLYGON_ONE 256
+
+// Convex polygon in either winding, pixel coordinates in 24.8
+typedef struct {
+  int32_t x[AA_POLYGON_MAX_VERTICES];
+  int32_t y[AA_POLYGON_MAX_VERTICES];
+  int count;
+} AaPolygon;
+
+static inline double aa_polygon_coord(int32_t v) { return v * (1.0 / AA_POLYGON_ONE); }
+
+// A primitive after setup, ready to be rasterized against any clip rect.
+// Rasterizing the same prim with different clip rects, or into surfaces with
+// different origins, touches exactly the same pixels as a single unclipped
+// draw, so work can be split into tiles.
+typedef struct {
+  RasterPrimType type;
+  BlendMode blend; // BLEND_MODE_REPLACE after setup
+  uint32_t color;  // Premultiplied unless blend is BLEND_MODE_REPLACE
+  uint32_t id;     // Written to the surface ids, RASTERIZER_NO_ID after setup
+  union {
+    Point v[3];
+    ThinLine line;
+    AaPolygon polygon;
+  };
+} RasterPrim;
+
+// Always opaque
+uint32_t pack_color(ColorF color);
+// Keeps alpha, only RASTER_MODE_ANALYTIC_AA blends with it
+uint32_t pack_color_alpha(ColorF color);
+// For the blend modes other than BLEND_MODE_REPLACE
+uint32_t pack_color_premultiplied(ColorF color);
+Rect rasterizer_surface_rect(const Surface *surface);
+// Address of pixel (x, y), which must be inside the surface rect
+static inline uint32_t *rasterizer_pixel(const Surface *surface, int x, int y) {
+  return &surface->buffer[(size_t)(y - surface->origin.y) * surface->width + (x - surface->origin.x)];
+}
+Rect rect_intersect(Rect a, Rect b);
+Rect rect_union(Rect a, Rect b);
+static inline int rect_is_empty(Rect r) { return r.x0 >= r.x1 || r.y0 >= r.y1; }
+
+// Reallocates the buffer only when the size changes, the contents are undefined afterwards
+void rasterizer_surface_resize(Surface *surface, uint32_t width, uint32_t height);
+void rasterizer_surface_free(Surface *surface);
+// Allocates or drops the id plane, the ids are undefined until the next clear
+void rasterizer_surface_set_ids(Surface *surface, bool enabled);
+
+void rasterizer_set_mode(Surface *surface, RasterMode mode);
+RasterMode rasterizer_get_mode(const Surface *surface);
+
 void rasterizer_set_clear_color(Surface *surface, ColorF color);
+// ARGB surfaces clear to the premultiplied clear color, XRGB ones to it opaque
+void rasterizer_set_format(Surface *surface, PixelFormat format);
+// Both clears reset the ids to RASTERIZER_NO_ID as well
 void rasterizer_clear_surface(Surface *surface);
+void rasterizer_clear_rect(Surface *surface, Rect rect);
 void rasterizer_draw_thick_line(Surface *surface, Point p0, Point p1, int thickness, ColorF color);
+// Thick line with the setup of the surface's RasterMode
+void rasterizer_draw_line(Surface *surface, vec2 p0, vec2 p1, float thickness, ColorF color);
+
+void draw_span(Surface *surface, int y, int x0, int x1, uint32_t color);
+void draw_filled_triangle(Surface *surface, Point p0, Point p1, Point p2, uint32_t color);
+
+// Setup / rasterize split used by the tiled backend, colors are packed. Lines are
+// trimmed to a fixed window around pixel zero rather than to the surface, so their
+// prims are the same whichever surface or tile they are set up for.
+int rasterizer_setup_thick_line(const Surface *surface, Point p0, Point p1, int thickness, uint32_t color, RasterPrim out[2]);
+int rasterizer_setup_thin_line(vec2 p0, vec2 p1, float thickness, uint32_t color, RasterPrim *out);
+int rasterizer_setup_thick_line_fixed(const Surface *surface, vec2 p0, vec2 p1, float thickness, uint32_t color, RasterPrim out[2]);
+int rasterizer_setup_thick_line_aa(vec2 p0, vec2 p1, float thickness, uint32_t color, RasterPrim *out);
+int rasterizer_setup_triangle_aa(vec2 p0, vec2 p1, vec2 p2, uint32_t color, RasterPrim *out);
+// Picks the setup for the thickness and the surface's RasterMode
+int rasterizer_setup_line(const Surface *surface, vec2 p0, vec2 p1, float thickness, uint32_t color, RasterPrim out[2]);
+Rect rasterizer_prim_bounds(const RasterPrim *prim);
+// Makes prims fresh from setup blend the premultiplied color instead of overwriting.
+// Every mode touches each pixel of a line once, so blended lines have no seams.
+void rasterizer_blend_prims(RasterPrim *prims, int count, BlendMode blend, uint32_t color);
+void rasterizer_draw_prim(Surface *surface, Rect clip, const RasterPrim *prim);
+// Draws prims in order, skipping the ones outside clip
+void rasterizer_draw_prims(Surface *surface, Rect clip, const RasterPrim *prims, int count);
 
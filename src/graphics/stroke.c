@@ -0,0 +1,305 @@
+#include "stroke.h"
+#include "halfspace.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define STROKE_PI 3.14159265f
+// Round parts stay within this many pixels of the true circle
+#define STROKE_ROUND_TOLERANCE 0.25f
+#define STROKE_MAX_ARC_STEPS 64
+// Keeps 28.4 coordinates far from overflowing, the half-space rasterizer clips anyway
+#define STROKE_COORD_LIMIT 4194304.0f
+
+void stroke_strip_free(StrokeStrip *strip) {
+  free(strip->vertices);
+  *strip = (StrokeStrip){0};
+}
+
+static void push(StrokeStrip *strip, Point p) {
+  if (strip->count == strip->capacity) {
+    strip->capacity = strip->capacity ? strip->capacity * 2 : 256;
+    strip->vertices = realloc(strip->vertices, strip->capacity * sizeof(Point));
+  }
+  strip->vertices[strip->count++] = p;
+}
+
+static Point to_fixed(float x, float y) {
+  x = fminf(fmaxf(x, -STROKE_COORD_LIMIT), STROKE_COORD_LIMIT);
+  y = fminf(fmaxf(y, -STROKE_COORD_LIMIT), STROKE_COORD_LIMIT);
+  return (Point){fixed_from_float(x), fixed_from_float(y)};
+}
+
+static Point point_add(Point a, Point b) { return (Point){a.x + b.x, a.y + b.y}; }
+static Point point_sub(Point a, Point b) { return (Point){a.x - b.x, a.y - b.y}; }
+
+// First point after i that differs from it, count when there is none
+static int next_distinct(const vec2 *points, int count, int i) {
+  int j = i + 1;
+  while (j < count && fabsf(points[j][0] - points[i][0]) < 1e-6f && fabsf(points[j][1] - points[i][1]) < 1e-6f) {
+    j++;
+  }
+  return j;
+}
+
+static float direction(const vec2 from, const vec2 to, vec2 dir) {
+  float dx = to[0] - from[0], dy = to[1] - from[1];
+  float length = sqrtf(dx * dx + dy * dy);
+  dir[0] = dx / length;
+  dir[1] = dy / length;
+  return length;
+}
+
+// Points of the arc from first to last around center, starting along the unit
+// vector from and sweeping angle radians. The ends are passed in so they match
+// the neighbouring vertices bit for bit.
+static int arc(Point *out, const vec2 center, const vec2 from, float angle, float radius, Point first, Point last) {
+  float step = radius > STROKE_ROUND_TOLERANCE ? 2.0f * acosf(1.0f - STROKE_ROUND_TOLERANCE / radius) : STROKE_PI * 0.5f;
+  int steps = (int)ceilf(fabsf(angle) / step);
+  steps = steps < 1 ? 1 : (steps > STROKE_MAX_ARC_STEPS ? STROKE_MAX_ARC_STEPS : steps);
+
+  out[0] = first;
+  for (int k = 1; k < steps; k++) {
+    float a = angle * k / steps;
+    float c = cosf(a), s = sinf(a);
+    out[k] = to_fixed(center[0] + (from[0] * c - from[1] * s) * radius, center[1] + (from[0] * s + from[1] * c) * radius);
+  }
+  out[steps] = last;
+  return steps + 1;
+}
+
+// Fan around pivot through points[0..count), the strip must end with points[0], pivot.
+// Afterwards it ends with pivot, points[count - 1].
+static void fan(StrokeStrip *strip, Point pivot, const Point *points, int count) {
+  for (int k = 1; k < count; k++) {
+    if (k > 1) {
+      push(strip, pivot);
+    }
+    push(strip, points[k]);
+  }
+}
+
+static void push_pair(StrokeStrip *strip, Point left, Point right, bool left_first) {
+  push(strip, left_first ? left : right);
+  push(strip, left_first ? right : left);
+}
+
+float stroke_outset(const StrokeStyle *style) {
+  float half_w = style->width * 0.5f;
+  float miter = style->join == STROKE_JOIN_MITER && style->miter_limit > 1.0f ? style->miter_limit : 1.0f;
+  float cap = style->cap == STROKE_CAP_SQUARE ? 1.41421356f : 1.0f;
+  return half_w * fmaxf(miter, cap);
+}
+
+static void tessellate_dot(StrokeStrip *strip, const vec2 p, const StrokeStyle *style, float half_w) {
+  Point center = to_fixed(p[0], p[1]);
+  if (style->cap == STROKE_CAP_SQUARE) {
+    Point h = to_fixed(half_w, half_w);
+    push(strip, (Point){center.x - h.x, center.y - h.y});
+    push(strip, (Point){center.x + h.x, center.y - h.y});
+    push(strip, (Point){center.x - h.x, center.y + h.y});
+    push(strip, (Point){center.x + h.x, center.y + h.y});
+  } else if (style->cap == STROKE_CAP_ROUND) {
+    Point points[STROKE_MAX_ARC_STEPS + 1];
+    Point first = to_fixed(p[0] + half_w, p[1]);
+    int n = arc(points, p, (vec2){1.0f, 0.0f}, 2.0f * STROKE_PI, half_w, first, first);
+    push(strip, first);
+    push(strip, center);
+    fan(strip, center, points, n);
+  }
+}
+
+void stroke_tessellate(StrokeStrip *strip, const vec2 *points, int count, const StrokeStyle *style) {
+  strip->count = 0;
+  float half_w = style->width * 0.5f;
+  if (count < 1 || half_w <= 0.0f)
+    return;
+
+  int i0 = 0;
+  int i1 = next_distinct(points, count, i0);
+  if (i1 >= count) {
+    tessellate_dot(strip, points[0], style, half_w);
+    return;
+  }
+
+  Point arc_points[STROKE_MAX_ARC_STEPS + 3];
+  vec2 d0, n0;
+  float length0 = direction(points[i0], points[i1], d0);
+  n0[0] = -d0[1];
+  n0[1] = d0[0];
+
+  // Start cap. Left and right are symmetric around the center in fixed point,
+  // so the triangle closing a round cap has exactly zero area.
+  vec2 start = {points[i0][0], points[i0][1]};
+  if (style->cap == STROKE_CAP_SQUARE) {
+    start[0] -= d0[0] * half_w;
+    start[1] -= d0[1] * half_w;
+  }
+  Point center = to_fixed(start[0], start[1]);
+  Point offset = to_fixed(n0[0] * half_w, n0[1] * half_w);
+  Point left = point_add(center, offset), right = point_sub(center, offset);
+  bool left_first = true;
+  // How far along the current segment the last inner corner reaches, and on which side
+  float inner_used = 0.0f;
+  bool used_left = false;
+  if (style->cap == STROKE_CAP_ROUND) {
+    // Half circle behind the start, from the left side around to the right
+    int n = arc(arc_points, start, n0, STROKE_PI, half_w, left, right);
+    push(strip, left);
+    push(strip, center);
+    fan(strip, center, arc_points, n);
+    push(strip, left);
+    left_first = false;
+  } else {
+    push_pair(strip, left, right, left_first);
+  }
+
+  for (int i2 = next_distinct(points, count, i1); i2 < count; i2 = next_distinct(points, count, i1)) {
+    const float *p = points[i1];
+    vec2 d1, n1;
+    float length1 = direction(p, points[i2], d1);
+    n1[0] = -d1[1];
+    n1[1] = d1[0];
+
+    // The side the path turns towards is the inner one
+    bool inner_left = d1[0] * n0[0] + d1[1] * n0[1] > 0.0f;
+    float outer = inner_left ? -1.0f : 1.0f;
+
+    // u halves the outer angle, the offset lines meet h / cos(half angle) along it
+    vec2 u;
+    float sum_x = n0[0] + n1[0], sum_y = n0[1] + n1[1];
+    float sum_length = sqrtf(sum_x * sum_x + sum_y * sum_y);
+    float cos_half = sum_length * 0.5f;
+    if (sum_length > 1e-4f) {
+      u[0] = outer * sum_x / sum_length;
+      u[1] = outer * sum_y / sum_length;
+    } else {
+      // Full reversal
+      u[0] = d0[0];
+      u[1] = d0[1];
+      cos_half = 0.0f;
+    }
+    float miter_length = cos_half > 1e-6f ? half_w / cos_half : INFINITY;
+
+    // The offset lines on the inner side meet this far along both segments. Past
+    // what is left of the incoming one, or past the outgoing one, that corner
+    // would fold the strip over itself. The segments then end square at the
+    // centerline instead and only overlap where they cover each other anyway.
+    float inner_reach = sqrtf(fmaxf(miter_length * miter_length - half_w * half_w, 0.0f));
+    float room0 = length0 - (used_left == inner_left ? inner_used : 0.0f);
+    bool split = !(inner_reach <= room0 && inner_reach <= length1);
+
+    // The join fans around pivot. Split corners are symmetric around it in fixed
+    // point, so the triangles turning the strip around the center have zero area.
+    Point pivot, inner0, inner1, outer0, outer1;
+    if (split) {
+      pivot = to_fixed(p[0], p[1]);
+      Point offset0 = to_fixed(outer * n0[0] * half_w, outer * n0[1] * half_w);
+      Point offset1 = to_fixed(outer * n1[0] * half_w, outer * n1[1] * half_w);
+      outer0 = point_add(pivot, offset0);
+      inner0 = point_sub(pivot, offset0);
+      outer1 = point_add(pivot, offset1);
+      inner1 = point_sub(pivot, offset1);
+    } else {
+      pivot = inner0 = inner1 = to_fixed(p[0] - u[0] * miter_length, p[1] - u[1] * miter_length);
+      outer0 = to_fixed(p[0] + outer * n0[0] * half_w, p[1] + outer * n0[1] * half_w);
+      outer1 = to_fixed(p[0] + outer * n1[0] * half_w, p[1] + outer * n1[1] * half_w);
+    }
+
+    // End of the incoming segment, then line the strip up as outer0, pivot
+    push_pair(strip, inner_left ? inner0 : outer0, inner_left ? outer0 : inner0, left_first);
+    if (split) {
+      if (left_first != inner_left) {
+        push(strip, outer0);
+      }
+      push(strip, pivot);
+    } else if (left_first == inner_left) {
+      push(strip, pivot);
+    }
+
+    int n;
+    if (style->join == STROKE_JOIN_ROUND) {
+      vec2 from = {outer * n0[0], outer * n0[1]};
+      float angle = acosf(fminf(fmaxf(n0[0] * n1[0] + n0[1] * n1[1], -1.0f), 1.0f));
+      if (from[0] * u[1] - from[1] * u[0] < 0.0f) {
+        angle = -angle;
+      }
+      n = arc(arc_points, p, from, angle, half_w, outer0, outer1);
+    } else if (style->join == STROKE_JOIN_MITER && miter_length <= half_w * style->miter_limit) {
+      arc_points[0] = outer0;
+      arc_points[1] = to_fixed(p[0] + u[0] * miter_length, p[1] + u[1] * miter_length);
+      arc_points[2] = outer1;
+      n = 3;
+    } else {
+      arc_points[0] = outer0;
+      arc_points[1] = outer1;
+      n = 2;
+    }
+    // The join closes the gap on the outer side, the strip then ends with pivot, outer1
+    fan(strip, pivot, arc_points, n);
+    if (split) {
+      // Start of the outgoing segment, the strip ends with outer1, inner1
+      push(strip, inner1);
+      left_first = !inner_left;
+      inner_used = 0.0f;
+    } else {
+      left_first = inner_left;
+      inner_used = inner_reach;
+      used_left = inner_left;
+    }
+
+    d0[0] = d1[0];
+    d0[1] = d1[1];
+    n0[0] = n1[0];
+    n0[1] = n1[1];
+    length0 = length1;
+    i1 = i2;
+  }
+
+  // End cap
+  vec2 end = {points[i1][0], points[i1][1]};
+  if (style->cap == STROKE_CAP_SQUARE) {
+    end[0] += d0[0] * half_w;
+    end[1] += d0[1] * half_w;
+  }
+  center = to_fixed(end[0], end[1]);
+  offset = to_fixed(n0[0] * half_w, n0[1] * half_w);
+  left = point_add(center, offset);
+  right = point_sub(center, offset);
+  push_pair(strip, left, right, left_first);
+  if (style->cap == STROKE_CAP_ROUND) {
+    // Half circle past the end, from the side pushed last around to the other one
+    push(strip, center);
+    if (left_first) {
+      int n = arc(arc_points, end, (vec2){-n0[0], -n0[1]}, STROKE_PI, half_w, right, left);
+      fan(strip, center, arc_points, n);
+    } else {
+      int n = arc(arc_points, end, n0, -STROKE_PI, half_w, left, right);
+      fan(strip, center, arc_points, n);
+    }
+  }
+}
+
+int stroke_setup_prims(const StrokeStrip *strip, uint32_t color, BlendMode blend, RasterPrim *out) {
+  int count = 0;
+  color = blend == BLEND_MODE_REPLACE ? color | 0xff000000 : blend_premultiply(color);
+  for (uint32_t i = 2; i < strip->count; i++) {
+    Point a = strip->vertices[i - 2], b = strip->vertices[i - 1], c = strip->vertices[i];
+    int64_t area = ((int64_t)b.x - a.x) * ((int64_t)c.y - a.y) - ((int64_t)b.y - a.y) * ((int64_t)c.x - a.x);
+    if (area == 0)
+      continue;
+    out[count++] = (RasterPrim){.type = RASTER_PRIM_TRIANGLE_FIXED, .blend = blend, .color = color, .v = {a, b, c}};
+  }
+  return count;
+}
+
+void stroke_draw_polyline(Surface *surface, const vec2 *points, int count, const StrokeStyle *style, ColorF color) {
+  StrokeStrip strip = {0};
+  stroke_tessellate(&strip, points, count, style);
+  RasterPrim *prims = malloc((strip.count ? strip.count : 1) * sizeof(RasterPrim));
+  BlendMode blend = color.a < 1.0f ? BLEND_MODE_SOURCE_OVER : BLEND_MODE_REPLACE;
+  int prim_count = stroke_setup_prims(&strip, pack_color_alpha(color), blend, prims);
+  rasterizer_draw_prims(surface, rasterizer_surface_rect(surface), prims, prim_count);
+  free(prims);
+  stroke_strip_free(&strip);
+}
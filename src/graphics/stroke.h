@@ -0,0 +1,55 @@
+#ifndef STROKE_H
+#define STROKE_H
+
+#include "rasterizer.h"
+#include <stdint.h>
+
+typedef enum {
+  STROKE_JOIN_MITER, // Falls back to bevel past miter_limit
+  STROKE_JOIN_BEVEL,
+  STROKE_JOIN_ROUND,
+} StrokeJoin;
+
+typedef enum {
+  STROKE_CAP_BUTT,
+  STROKE_CAP_SQUARE,
+  STROKE_CAP_ROUND,
+} StrokeCap;
+
+typedef struct {
+  float width;
+  StrokeJoin join;
+  StrokeCap cap;
+  float miter_limit; // Miter length over half the width, 4 is the usual default
+} StrokeStyle;
+
+// Triangle strip in 28.4 fixed point, triangle i is vertices i, i+1, i+2.
+// Joins and round parts are fans folded into the strip with repeated
+// vertices, their zero area triangles are dropped on setup.
+typedef struct {
+  Point *vertices;
+  uint32_t count;
+  uint32_t capacity;
+} StrokeStrip;
+
+void stroke_strip_free(StrokeStrip *strip);
+
+// Outline of the path through points, in screen space, replaces the strip's contents.
+// Neighbouring triangles share their vertices exactly, so with the half-space
+// fill rule every pixel of the stroke is written once, joints included. Only
+// where the path doubles back over itself are the overlapping segments both
+// drawn, rasterizer_bench --check counts the writes.
+void stroke_tessellate(StrokeStrip *strip, const vec2 *points, int count, const StrokeStyle *style);
+
+// World-space extent of the stroke past its centerline, for bounds
+float stroke_outset(const StrokeStyle *style);
+
+// One RASTER_PRIM_TRIANGLE_FIXED per non-degenerate strip triangle, out holds strip->count prims.
+// color is straight alpha like pack_color_alpha. BLEND_MODE_REPLACE draws it opaque, the other
+// modes blend it premultiplied, the strip writes each pixel once so a translucent stroke has no seams.
+int stroke_setup_prims(const StrokeStrip *strip, uint32_t color, BlendMode blend, RasterPrim *out);
+
+// Translucent colors blend source over
+void stroke_draw_polyline(Surface *surface, const vec2 *points, int count, const StrokeStyle *style, ColorF color);
+
+#endif // STROKE_H
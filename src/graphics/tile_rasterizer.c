@@ -0,0 +1,139 @@
+#include "tile_rasterizer.h"
+#include "../profiler.h"
+#include <stdlib.h>
+
+static void bin_push(TileBin *bin, uint32_t index) {
+  if (bin->count == bin->capacity) {
+    bin->capacity = bin->capacity ? bin->capacity * 2 : 64;
+    bin->prims = realloc(bin->prims, bin->capacity * sizeof(uint32_t));
+  }
+  bin->prims[bin->count++] = index;
+}
+
+static void free_bins(TileRasterizer *tiler) {
+  uint32_t tile_count = tiler->tiles_x * tiler->tiles_y;
+  for (uint32_t i = 0; i < tile_count; i++) {
+    free(tiler->bins[i].prims);
+  }
+  free(tiler->bins);
+  tiler->bins = NULL;
+  tiler->tiles_x = 0;
+  tiler->tiles_y = 0;
+}
+
+static void rasterize_tile(void *ctx, uint32_t index) {
+  TileRasterizer *tiler = ctx;
+  TileBin *bin = &tiler->bins[index];
+  if (bin->count == 0)
+    return;
+
+  PROFILE_BEGIN("rasterize tile");
+  int tx = index % tiler->tiles_x;
+  int ty = index / tiler->tiles_x;
+  Point o = tiler->surface->origin;
+  Rect tile = {o.x + tx * TILE_SIZE, o.y + ty * TILE_SIZE, o.x + (tx + 1) * TILE_SIZE, o.y + (ty + 1) * TILE_SIZE};
+  tile = rect_intersect(tile, rasterizer_surface_rect(tiler->surface));
+
+  if (tiler->clip_count == 0) {
+    for (uint32_t i = 0; i < bin->count; i++) {
+      rasterizer_draw_prim(tiler->surface, tile, &tiler->prims[bin->prims[i]]);
+    }
+  } else {
+    // Overlapping clips replay the same sequence, so the result doesn't change
+    for (int c = 0; c < tiler->clip_count; c++) {
+      Rect clip = rect_intersect(tile, tiler->clips[c]);
+      if (rect_is_empty(clip))
+        continue;
+      for (uint32_t i = 0; i < bin->count; i++) {
+        rasterizer_draw_prim(tiler->surface, clip, &tiler->prims[bin->prims[i]]);
+      }
+    }
+  }
+  bin->count = 0;
+  PROFILE_END();
+}
+
+TileRasterizer *tile_rasterizer_create(ThreadPool *pool) {
+  TileRasterizer *tiler = calloc(1, sizeof(TileRasterizer));
+  tiler->pool = pool;
+  return tiler;
+}
+
+void tile_rasterizer_free(TileRasterizer *tiler) {
+  if (!tiler)
+    return;
+  free_bins(tiler);
+  free(tiler->prims);
+  free(tiler);
+}
+
+void tile_rasterizer_begin(TileRasterizer *tiler, Surface *surface, const Rect *clips, int clip_count) {
+  uint32_t tiles_x = (surface->width + TILE_SIZE - 1) / TILE_SIZE;
+  uint32_t tiles_y = (surface->height + TILE_SIZE - 1) / TILE_SIZE;
+
+  if (tiles_x != tiler->tiles_x || tiles_y != tiler->tiles_y) {
+    free_bins(tiler);
+    tiler->bins = calloc(tiles_x * tiles_y, sizeof(TileBin));
+    tiler->tiles_x = tiles_x;
+    tiler->tiles_y = tiles_y;
+  }
+
+  tiler->surface = surface;
+  tiler->clips = clips;
+  tiler->clip_count = clips ? clip_count : 0;
+  tiler->prim_count = 0;
+}
+
+void tile_rasterizer_add_prim(TileRasterizer *tiler, const RasterPrim *prim) {
+  Rect bounds = rect_intersect(rasterizer_prim_bounds(prim), rasterizer_surface_rect(tiler->surface));
+  if (rect_is_empty(bounds))
+    return;
+
+  if (tiler->prim_count == tiler->prim_capacity) {
+    tiler->prim_capacity = tiler->prim_capacity ? tiler->prim_capacity * 2 : 1024;
+    tiler->prims = realloc(tiler->prims, tiler->prim_capacity * sizeof(RasterPrim));
+  }
+  uint32_t index = tiler->prim_count++;
+  tiler->prims[index] = *prim;
+
+  // Bins count from the surface origin
+  Point o = tiler->surface->origin;
+  int tx0 = (bounds.x0 - o.x) / TILE_SIZE;
+  int ty0 = (bounds.y0 - o.y) / TILE_SIZE;
+  int tx1 = (bounds.x1 - 1 - o.x) / TILE_SIZE;
+  int ty1 = (bounds.y1 - 1 - o.y) / TILE_SIZE;
+  for (int ty = ty0; ty <= ty1; ty++) {
+    for (int tx = tx0; tx <= tx1; tx++) {
+      bin_push(&tiler->bins[ty * tiler->tiles_x + tx], index);
+    }
+  }
+}
+
+void tile_rasterizer_add_prims(TileRasterizer *tiler, const RasterPrim *prims, int count) {
+  uint32_t needed = tiler->prim_count + count;
+  if (needed > tiler->prim_capacity) {
+    while (tiler->prim_capacity < needed) {
+      tiler->prim_capacity = tiler->prim_capacity ? tiler->prim_capacity * 2 : 1024;
+    }
+    tiler->prims = realloc(tiler->prims, tiler->prim_capacity * sizeof(RasterPrim));
+  }
+  for (int i = 0; i < count; i++) {
+    tile_rasterizer_add_prim(tiler, &prims[i]);
+  }
+}
+
+void tile_rasterizer_add_line(TileRasterizer *tiler, vec2 p0, vec2 p1, float thickness, ColorF color) {
+  RasterPrim prims[2];
+  int count = rasterizer_setup_line(tiler->surface, p0, p1, thickness, pack_color(color), prims);
+  for (int i = 0; i < count; i++) {
+    tile_rasterizer_add_prim(tiler, &prims[i]);
+  }
+}
+
+void tile_rasterizer_flush(TileRasterizer *tiler) {
+  if (tiler->prim_count == 0)
+    return;
+
+  thread_pool_parallel_for(tiler->pool, tiler->tiles_x * tiler->tiles_y, rasterize_tile, tiler);
+  tiler->prim_count = 0;
+}
@@ -0,0 +1,46 @@
+#ifndef TILE_RASTERIZER_H
+#define TILE_RASTERIZER_H
+
+#include "../thread_pool.h"
+#include "rasterizer.h"
+
+#define TILE_SIZE 64
+
+typedef struct {
+  uint32_t *prims; // Indices into TileRasterizer.prims, in submission order
+  uint32_t count;
+  uint32_t capacity;
+} TileBin;
+
+// Bins set up primitives into TILE_SIZE x TILE_SIZE tiles and rasterizes the
+// tiles in parallel. Each tile replays its bin in submission order, so the
+// result is identical to drawing the same primitives serially.
+typedef struct TileRasterizer {
+  ThreadPool *pool;
+  Surface *surface;
+  // Optional, restricts rasterization to these rects
+  const Rect *clips;
+  int clip_count;
+
+  RasterPrim *prims;
+  uint32_t prim_count;
+  uint32_t prim_capacity;
+
+  TileBin *bins;
+  uint32_t tiles_x;
+  uint32_t tiles_y;
+} TileRasterizer;
+
+TileRasterizer *tile_rasterizer_create(ThreadPool *pool);
+void tile_rasterizer_free(TileRasterizer *tiler);
+
+// Starts a new batch targeting surface, re-sizing the bin grid when needed.
+// clips may be NULL for the whole surface, it must stay alive until the flush.
+void tile_rasterizer_begin(TileRasterizer *tiler, Surface *surface, const Rect *clips, int clip_count);
+void tile_rasterizer_add_prim(TileRasterizer *tiler, const RasterPrim *prim);
+void tile_rasterizer_add_prims(TileRasterizer *tiler, const RasterPrim *prims, int count);
+void tile_rasterizer_add_line(TileRasterizer *tiler, vec2 p0, vec2 p1, float thickness, ColorF color);
+// Rasterizes every binned primitive and empties the bins
+void tile_rasterizer_flush(TileRasterizer *tiler);
+
+#endif // TILE_RASTERIZER_H
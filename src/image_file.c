@@ -0,0 +1,113 @@
+#include "image_file.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_HEADER_SIZE 14
+#define QOI_MAX_RUN 62
+
+static const uint8_t qoi_end_marker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+const char *image_format_extension(ImageFormat format) { return format == IMAGE_FORMAT_QOI ? "qoi" : "ppm"; }
+
+static bool write_ppm(FILE *file, const Surface *surface) {
+  uint8_t *row = malloc((size_t)surface->width * 3);
+  bool ok = fprintf(file, "P6\n%u %u\n255\n", surface->width, surface->height) > 0;
+  for (uint32_t y = 0; y < surface->height && ok; y++) {
+    const uint32_t *pixels = &surface->buffer[(size_t)y * surface->width];
+    for (uint32_t x = 0; x < surface->width; x++) {
+      row[x * 3 + 0] = (uint8_t)(pixels[x] >> 16);
+      row[x * 3 + 1] = (uint8_t)(pixels[x] >> 8);
+      row[x * 3 + 2] = (uint8_t)pixels[x];
+    }
+    ok = fwrite(row, 3, surface->width, file) == surface->width;
+  }
+  free(row);
+  return ok;
+}
+
+static uint8_t *put_u32_be(uint8_t *out, uint32_t value) {
+  out[0] = (uint8_t)(value >> 24);
+  out[1] = (uint8_t)(value >> 16);
+  out[2] = (uint8_t)(value >> 8);
+  out[3] = (uint8_t)value;
+  return out + 4;
+}
+
+// https://qoiformat.org/qoi-specification.pdf, three channels so alpha stays 255
+static bool write_qoi(FILE *file, const Surface *surface) {
+  size_t pixel_count = (size_t)surface->width * surface->height;
+  uint8_t *data = malloc(QOI_HEADER_SIZE + pixel_count * 4 + sizeof(qoi_end_marker));
+  uint8_t *out = data;
+  *out++ = 'q';
+  *out++ = 'o';
+  *out++ = 'i';
+  *out++ = 'f';
+  out = put_u32_be(out, surface->width);
+  out = put_u32_be(out, surface->height);
+  *out++ = 3; // RGB
+  *out++ = 0; // sRGB
+
+  uint32_t index[64] = {0};
+  uint32_t prev = 0xff000000;
+  int run = 0;
+  for (size_t i = 0; i < pixel_count; i++) {
+    uint32_t pixel = surface->buffer[i] | 0xff000000;
+    if (pixel == prev) {
+      if (++run == QOI_MAX_RUN || i == pixel_count - 1) {
+        *out++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      *out++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+      run = 0;
+    }
+
+    uint8_t r = (uint8_t)(pixel >> 16), g = (uint8_t)(pixel >> 8), b = (uint8_t)pixel;
+    int hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+    if (index[hash] == pixel) {
+      *out++ = (uint8_t)(QOI_OP_INDEX | hash);
+    } else {
+      index[hash] = pixel;
+      int8_t dr = (int8_t)(r - (uint8_t)(prev >> 16));
+      int8_t dg = (int8_t)(g - (uint8_t)(prev >> 8));
+      int8_t db = (int8_t)(b - (uint8_t)prev);
+      int8_t dr_dg = (int8_t)(dr - dg), db_dg = (int8_t)(db - dg);
+      if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+        *out++ = (uint8_t)(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+      } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+        *out++ = (uint8_t)(QOI_OP_LUMA | (dg + 32));
+        *out++ = (uint8_t)((dr_dg + 8) << 4 | (db_dg + 8));
+      } else {
+        *out++ = QOI_OP_RGB;
+        *out++ = r;
+        *out++ = g;
+        *out++ = b;
+      }
+    }
+    prev = pixel;
+  }
+  for (size_t i = 0; i < sizeof(qoi_end_marker); i++) {
+    *out++ = qoi_end_marker[i];
+  }
+
+  size_t size = (size_t)(out - data);
+  bool ok = fwrite(data, 1, size, file) == size;
+  free(data);
+  return ok;
+}
+
+bool image_file_write(const char *path, const Surface *surface, ImageFormat format) {
+  FILE *file = fopen(path, "wb");
+  if (!file)
+    return false;
+  bool ok = format == IMAGE_FORMAT_QOI ? write_qoi(file, surface) : write_ppm(file, surface);
+  return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,19 @@
+#ifndef IMAGE_FILE_H
+#define IMAGE_FILE_H
+
+#include "graphics/rasterizer.h"
+#include <stdbool.h>
+
+typedef enum {
+  IMAGE_FORMAT_PPM, // Binary P6
+  IMAGE_FORMAT_QOI,
+} ImageFormat;
+
+// Without the dot
+const char *image_format_extension(ImageFormat format);
+
+// Writes the surface as an opaque RGB image, alpha is dropped.
+// Thread safe, false when the file can't be written.
+bool image_file_write(const char *path, const Surface *surface, ImageFormat format);
+
+#endif // IMAGE_FILE_H
@@ -0,0 +1,207 @@
+#include "line_index.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define LINE_INDEX_MIN_SLOTS 64
+
+typedef struct {
+  int32_t x0, y0, x1, y1; // inclusive
+} CellRange;
+
+static inline int32_t cell_coord(float v) {
+  float c = floorf(v / LINE_INDEX_CELL_SIZE);
+  // Keep far away or non finite coordinates representable
+  if (!(c > -1.0e9f))
+    return -1000000000;
+  if (c > 1.0e9f)
+    return 1000000000;
+  return (int32_t)c;
+}
+
+static inline CellRange cell_range(const vec2 min, const vec2 max) {
+  return (CellRange){cell_coord(min[0]), cell_coord(min[1]), cell_coord(max[0]), cell_coord(max[1])};
+}
+
+static inline int64_t cell_range_count(CellRange r) { return (int64_t)(r.x1 - r.x0 + 1) * (r.y1 - r.y0 + 1); }
+
+static inline uint32_t cell_hash(int32_t cx, int32_t cy) {
+  uint64_t h = ((uint64_t)(uint32_t)cx << 32 | (uint32_t)cy) * 0x9E3779B97F4A7C15ull;
+  return (uint32_t)(h >> 32);
+}
+
+static inline bool bounds_overlap(const LineBounds *b, const vec2 min, const vec2 max) {
+  return b->min[0] <= max[0] && min[0] <= b->max[0] && b->min[1] <= max[1] && min[1] <= b->max[1];
+}
+
+static LineIndexCell *find_cell(const LineIndex *index, int32_t cx, int32_t cy) {
+  if (!index->slot_capacity)
+    return NULL;
+
+  uint32_t mask = index->slot_capacity - 1;
+  for (uint32_t i = cell_hash(cx, cy) & mask;; i = (i + 1) & mask) {
+    uint32_t slot = index->slots[i];
+    if (!slot)
+      return NULL;
+    LineIndexCell *cell = &index->cells[slot - 1];
+    if (cell->cx == cx && cell->cy == cy)
+      return cell;
+  }
+}
+
+static void insert_slot(LineIndex *index, uint32_t cell_index) {
+  LineIndexCell *cell = &index->cells[cell_index];
+  uint32_t mask = index->slot_capacity - 1;
+  uint32_t i = cell_hash(cell->cx, cell->cy) & mask;
+  while (index->slots[i]) {
+    i = (i + 1) & mask;
+  }
+  index->slots[i] = cell_index + 1;
+}
+
+// Cells are never removed, an emptied cell is reused when lines come back
+static LineIndexCell *get_or_add_cell(LineIndex *index, int32_t cx, int32_t cy) {
+  LineIndexCell *cell = find_cell(index, cx, cy);
+  if (cell)
+    return cell;
+
+  // Keep the load factor at most one half
+  if ((index->cell_count + 1) * 2 > index->slot_capacity) {
+    uint32_t capacity = index->slot_capacity ? index->slot_capacity * 2 : LINE_INDEX_MIN_SLOTS;
+    free(index->slots);
+    index->slots = calloc(capacity, sizeof(uint32_t));
+    index->slot_capacity = capacity;
+    for (uint32_t i = 0; i < index->cell_count; i++) {
+      insert_slot(index, i);
+    }
+  }
+  if (index->cell_count == index->cell_capacity) {
+    index->cell_capacity = index->cell_capacity ? index->cell_capacity * 2 : LINE_INDEX_MIN_SLOTS / 2;
+    index->cells = realloc(index->cells, index->cell_capacity * sizeof(LineIndexCell));
+  }
+
+  uint32_t cell_index = index->cell_count++;
+  index->cells[cell_index] = (LineIndexCell){.cx = cx, .cy = cy};
+  insert_slot(index, cell_index);
+  return &index->cells[cell_index];
+}
+
+static void cell_push(LineIndexCell *cell, const LineIndexEntry *entry) {
+  if (cell->count == cell->capacity) {
+    cell->capacity = cell->capacity ? cell->capacity * 2 : 4;
+    cell->entries = realloc(cell->entries, cell->capacity * sizeof(LineIndexEntry));
+  }
+  cell->entries[cell->count++] = *entry;
+}
+
+static void cell_remove(LineIndexCell *cell, ecs_entity_t entity) {
+  for (uint32_t i = 0; i < cell->count; i++) {
+    if (cell->entries[i].entity == entity) {
+      cell->entries[i] = cell->entries[--cell->count];
+      return;
+    }
+  }
+}
+
+static void visit_cell(const LineIndexCell *cell, const vec2 min, const vec2 max, LineIndexVisitFn visit, void *ctx) {
+  for (uint32_t i = 0; i < cell->count; i++) {
+    const LineIndexEntry *entry = &cell->entries[i];
+    if (!bounds_overlap(&entry->bounds, min, max))
+      continue;
+
+    // Report from the first cell of the overlap only
+    int32_t first_x = cell_coord(fmaxf(entry->bounds.min[0], min[0]));
+    int32_t first_y = cell_coord(fmaxf(entry->bounds.min[1], min[1]));
+    if (first_x == cell->cx && first_y == cell->cy) {
+      visit(ctx, entry);
+    }
+  }
+}
+
+static float bounds_extent(const LineBounds *bounds) {
+  return fmaxf(bounds->max[0] - bounds->min[0], bounds->max[1] - bounds->min[1]) - LINE_THICKNESS;
+}
+
+void line_index_init(LineIndex *index) { *index = (LineIndex){0}; }
+
+void line_index_free(LineIndex *index) {
+  for (uint32_t i = 0; i < index->cell_count; i++) {
+    free(index->cells[i].entries);
+  }
+  free(index->cells);
+  free(index->slots);
+  free(index->large.entries);
+  *index = (LineIndex){0};
+}
+
+void line_index_insert(LineIndex *index, ecs_entity_t entity, const Line *line, const Position *position, const LineBounds *bounds) {
+  LineIndexEntry entry = {.entity = entity, .bounds = *bounds};
+  glm_vec2_add((float *)position->pos, (float *)line->a, entry.a);
+  glm_vec2_add((float *)position->pos, (float *)line->b, entry.b);
+  index->line_count++;
+  index->total_extent += bounds_extent(bounds);
+
+  CellRange r = cell_range(bounds->min, bounds->max);
+  if (cell_range_count(r) > LINE_INDEX_MAX_LINE_CELLS) {
+    cell_push(&index->large, &entry);
+    return;
+  }
+  for (int32_t cy = r.y0; cy <= r.y1; cy++) {
+    for (int32_t cx = r.x0; cx <= r.x1; cx++) {
+      cell_push(get_or_add_cell(index, cx, cy), &entry);
+    }
+  }
+}
+
+void line_index_remove(LineIndex *index, ecs_entity_t entity, const LineBounds *bounds) {
+  index->line_count--;
+  index->total_extent -= bounds_extent(bounds);
+  if (index->line_count == 0) {
+    index->total_extent = 0.0; // Drops the accumulated rounding
+  }
+
+  CellRange r = cell_range(bounds->min, bounds->max);
+  if (cell_range_count(r) > LINE_INDEX_MAX_LINE_CELLS) {
+    cell_remove(&index->large, entity);
+    return;
+  }
+  for (int32_t cy = r.y0; cy <= r.y1; cy++) {
+    for (int32_t cx = r.x0; cx <= r.x1; cx++) {
+      LineIndexCell *cell = find_cell(index, cx, cy);
+      if (cell) {
+        cell_remove(cell, entity);
+      }
+    }
+  }
+}
+
+float line_index_mean_extent(const LineIndex *index) { return index->line_count ? (float)(index->total_extent / index->line_count) : 0.0f; }
+
+void line_index_query(const LineIndex *index, vec2 min, vec2 max, LineIndexVisitFn visit, void *ctx) {
+  for (uint32_t i = 0; i < index->large.count; i++) {
+    if (bounds_overlap(&index->large.entries[i].bounds, min, max)) {
+      visit(ctx, &index->large.entries[i]);
+    }
+  }
+
+  // Zoomed out past the occupied cells, walking them beats walking the range
+  CellRange r = cell_range(min, max);
+  if (cell_range_count(r) > index->cell_count) {
+    for (uint32_t i = 0; i < index->cell_count; i++) {
+      const LineIndexCell *cell = &index->cells[i];
+      if (cell->cx >= r.x0 && cell->cx <= r.x1 && cell->cy >= r.y0 && cell->cy <= r.y1) {
+        visit_cell(cell, min, max, visit, ctx);
+      }
+    }
+    return;
+  }
+
+  for (int32_t cy = r.y0; cy <= r.y1; cy++) {
+    for (int32_t cx = r.x0; cx <= r.x1; cx++) {
+      const LineIndexCell *cell = find_cell(index, cx, cy);
+      if (cell) {
+        visit_cell(cell, min, max, visit, ctx);
+      }
+    }
+  }
+}
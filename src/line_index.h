@@ -0,0 +1,58 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include "components.h"
+#include "flecs.h"
+#include <stdint.h>
+
+// World units per grid cell
+#define LINE_INDEX_CELL_SIZE 256.0f
+// Lines covering more cells than this skip the grid and are always visited
+#define LINE_INDEX_MAX_LINE_CELLS 64
+
+// A line in world space, bounds as in LineBounds
+typedef struct {
+  ecs_entity_t entity;
+  vec2 a;
+  vec2 b;
+  LineBounds bounds;
+} LineIndexEntry;
+
+typedef struct {
+  int32_t cx;
+  int32_t cy;
+  LineIndexEntry *entries;
+  uint32_t count;
+  uint32_t capacity;
+} LineIndexCell;
+
+// Sparse uniform grid over world space. A line is stored in every cell its
+// bounds overlap, queries report it once from the first overlapping cell.
+typedef struct {
+  LineIndexCell *cells;
+  uint32_t cell_count;
+  uint32_t cell_capacity;
+
+  // Open addressing from cell coordinates to cells index + 1, 0 is empty
+  uint32_t *slots;
+  uint32_t slot_capacity;
+
+  LineIndexCell large;
+  uint32_t line_count;
+  // Sum of the major axis extents of the lines, stroke excluded
+  double total_extent;
+} LineIndex;
+
+typedef void (*LineIndexVisitFn)(void *ctx, const LineIndexEntry *entry);
+
+void line_index_init(LineIndex *index);
+void line_index_free(LineIndex *index);
+void line_index_insert(LineIndex *index, ecs_entity_t entity, const Line *line, const Position *position, const LineBounds *bounds);
+// bounds must be the ones the entity was inserted with
+void line_index_remove(LineIndex *index, ecs_entity_t entity, const LineBounds *bounds);
+// Average major axis extent of the lines in world units, 0 when empty
+float line_index_mean_extent(const LineIndex *index);
+// Visits every line whose bounds overlap [min, max] exactly once
+void line_index_query(const LineIndex *index, vec2 min, vec2 max, LineIndexVisitFn visit, void *ctx);
+
+#endif // LINE_INDEX_H
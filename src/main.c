@@ -1,3 +1,4 @@
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -13,12 +14,18 @@
 #include <cglm/vec2.h>
 
 #include "canvas.h"
+#include "clock.h"
+#include "components.h"
 #include "flecs.h"
 #include "flecs/addons/flecs_c.h"
 #include "flecs/private/api_defines.h"
 #include "graphics/rasterizer.h"
 #include "input.h"
+#include "picking.h"
+#include "profiler.h"
 #include "renderer.h"
+#include "scene_file.h"
+#include "scene_stream.h"
 
 #define CIMGUI_USE_OPENGL3
 #define CIMGUI_USE_SDL3
@@ -32,16 +39,39 @@
 
 #define WIDTH 800
 #define HEIGHT 600
+// Main thread time per frame spent inserting streamed lines
+#define SCENE_STREAM_FRAME_BUDGET_NS 4000000
+
+// ImGui colors are ABGR
+#define PICK_HOVER_COLOR 0xff00c0ffu
+#define PICK_BOX_COLOR 0xffffffffu
+#define PICK_BOX_FILL_COLOR 0x30ffffffu
 
 typedef struct {
   bool running;
   bool show_debug;
+
+  // Picking, in screen pixels
+  vec2 mouse;
+  bool selecting; // Left button held, the box goes from select_start to the mouse
+  vec2 select_start;
+  ecs_entity_t hovered;
+  PickSet picked;
 } AppState;
 
 ECS_COMPONENT_DECLARE(AppState);
 ECS_COMPONENT_DECLARE(ResizeParams);
 ECS_COMPONENT_DECLARE(Canvas);
 ECS_COMPONENT_DECLARE(Surface);
+ECS_COMPONENT_DECLARE(Position);
+ECS_COMPONENT_DECLARE(Line);
+ECS_COMPONENT_DECLARE(LineBounds);
+ECS_COMPONENT_DECLARE(ScreenLine);
+ECS_COMPONENT_DECLARE(LineQuads);
+ECS_COMPONENT_DECLARE(Polyline);
+ECS_COMPONENT_DECLARE(PolylineStroke);
+ECS_COMPONENT_DECLARE(Selected);
+ECS_COMPONENT_DECLARE(SoftwareOpenGlRenderer);
 
 // // Apply zoom scale with clamping
 // void canvas_apply_zoom(Canvas *canvas, float zoom_factor) {
@@ -91,6 +121,46 @@ ECS_COMPONENT_DECLARE(Surface);
 //   canvas_translate(canvas, world_before[0] - world_after[0], world_before[1] - world_after[1]);
 // }
 
+// Pixels inside the selection box, a click is one pixel
+static Rect selection_rect(const AppState *app_state) {
+  const float *a = app_state->select_start, *b = app_state->mouse;
+  return (Rect){
+      (int)floorf(fminf(a[0], b[0])),
+      (int)floorf(fminf(a[1], b[1])),
+      (int)floorf(fmaxf(a[0], b[0])) + 1,
+      (int)floorf(fmaxf(a[1], b[1])) + 1,
+  };
+}
+
+// Surface pixels under a screen rect, the surface may be drawn at a lower resolution
+static Rect surface_rect_from_screen(const Canvas *canvas, Rect rect) {
+  float r = canvas->resolution_scale;
+  return (Rect){
+      (int)floorf(rect.x0 * r),
+      (int)floorf(rect.y0 * r),
+      (int)ceilf(rect.x1 * r),
+      (int)ceilf(rect.y1 * r),
+  };
+}
+
+// Replaces the selection with whatever was drawn inside the box
+static void select_box(AppState *app_state, ecs_world_t *world) {
+  SoftwareOpenGlRenderer *renderer = ecs_singleton_get_mut(world, SoftwareOpenGlRenderer);
+  const Surface *surface = &renderer->draw_context.surface;
+  if (!surface->ids)
+    return;
+
+  PickSet *picked = &app_state->picked;
+  Rect rect = surface_rect_from_screen(&renderer->draw_context.canvas, selection_rect(app_state));
+  picking_entities_in_rect(world, surface, rect, picked);
+  ecs_remove_all(world, ecs_id(Selected));
+  for (uint32_t i = 0; i < picked->count; i++) {
+    ecs_add(world, picked->entities[i], Selected);
+  }
+  // Old and new highlights may be anywhere
+  damage_add_full(&renderer->damage);
+}
+
 void handle_input(AppState *app_state, ecs_world_t *world, ecs_entity_t surface_resize_s) {
   SDL_Event event;
   while (SDL_PollEvent(&event)) {
@@ -101,6 +171,26 @@ void handle_input(AppState *app_state, ecs_world_t *world, ecs_entity_t surface_
       // ecs_set(world, ecs_id(ResizeParams), ResizeParams, {.width = event.window.data1, .height = event.window.data2});
     }
 
+    if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_F5) {
+      bool saved = scene_file_write(world, "scene.bin");
+      SDL_Log("%s scene.bin", saved ? "Saved" : "Failed to save");
+    }
+
+    // Box selection with the left button, outside the debug panel
+    if (event.type == SDL_EVENT_MOUSE_MOTION) {
+      app_state->mouse[0] = event.motion.x;
+      app_state->mouse[1] = event.motion.y;
+    }
+    if (event.type == SDL_EVENT_MOUSE_BUTTON_DOWN && event.button.button == SDL_BUTTON_LEFT && !igGetIO()->WantCaptureMouse) {
+      app_state->selecting = true;
+      app_state->select_start[0] = app_state->mouse[0] = event.button.x;
+      app_state->select_start[1] = app_state->mouse[1] = event.button.y;
+    }
+    if (event.type == SDL_EVENT_MOUSE_BUTTON_UP && event.button.button == SDL_BUTTON_LEFT && app_state->selecting) {
+      app_state->selecting = false;
+      select_box(app_state, world);
+    }
+
     // if (event->type == SDL_EVENT_KEY_DOWN) {
     //   switch (event->key.key) {
     //   case SDLK_F1:
@@ -167,13 +257,63 @@ void handle_input(AppState *app_state, ecs_world_t *world, ecs_entity_t surface_
     // }
 
     if (event.type == SDL_EVENT_WINDOW_RESIZED) {
-      ResizeParams resize_params = {.width = WIDTH, .height = HEIGHT};
+      ResizeParams resize_params = {.width = event.window.data1, .height = event.window.data2};
       ecs_run(world, surface_resize_s, 0.0, &resize_params);
     }
   }
 }
 
-void imgui_render(AppState *app_state, Canvas *canvas, ImGuiIO *io) {
+#ifdef PROFILER_ENABLED
+static void imgui_profiler_panel(void) {
+  const ProfilerStats *stats = profiler_stats();
+  igText("Profiler");
+
+  char overlay[32];
+  snprintf(overlay, sizeof(overlay), "%.2f ms", stats->last_frame_ms);
+  igPlotLines_FloatPtr("##frame_time", stats->frame_ms, PROFILER_HISTORY, stats->history_head, overlay, 0.0f, 33.3f, (ImVec2){0, 60},
+                       sizeof(float));
+
+  // Average, worst frame in the graph, calls last frame
+  for (int i = 0; i < stats->zone_count; i++) {
+    const ProfilerZoneStats *zone = &stats->zones[i];
+    igText("%-22s %6.2f ms  max %6.2f  x%u", zone->name, zone->average_ms, zone->max_ms, zone->calls);
+  }
+
+  static bool dumped = false;
+  if (igButton("Dump Chrome trace", (ImVec2){0, 0})) {
+    dumped = profiler_dump_chrome_trace("trace.json");
+  }
+  if (dumped) {
+    igSameLine(0.0f, -1.0f);
+    igText("trace.json");
+  }
+}
+#endif
+
+// Outlines the hovered line and the selection box over the surface
+static void draw_picking_overlay(const AppState *app_state, ecs_world_t *world, Canvas *canvas) {
+  ImDrawList *draw_list = igGetWindowDrawList();
+  const Line *line = app_state->hovered ? ecs_get(world, app_state->hovered, Line) : NULL;
+  const Position *position = app_state->hovered ? ecs_get(world, app_state->hovered, Position) : NULL;
+  if (line && position) {
+    vec2 a = {position->pos[0] + line->a[0], position->pos[1] + line->a[1]};
+    vec2 b = {position->pos[0] + line->b[0], position->pos[1] + line->b[1]};
+    canvas_world_to_screen(canvas, a, a);
+    canvas_world_to_screen(canvas, b, b);
+    ImDrawList_AddLine(draw_list, (ImVec2){a[0], a[1]}, (ImVec2){b[0], b[1]}, PICK_HOVER_COLOR, LINE_THICKNESS * canvas->scale + 2.0f);
+  }
+
+  if (app_state->selecting) {
+    Rect box = selection_rect(app_state);
+    ImVec2 min = {(float)box.x0, (float)box.y0}, max = {(float)box.x1, (float)box.y1};
+    ImDrawList_AddRectFilled(draw_list, min, max, PICK_BOX_FILL_COLOR, 0.0f, 0);
+    ImDrawList_AddRect(draw_list, min, max, PICK_BOX_COLOR, 0.0f, 0, 1.0f);
+  }
+}
+
+void imgui_render(AppState *app_state, ecs_world_t *world, SoftwareOpenGlRenderer *renderer, ImGuiIO *io) {
+  Canvas *canvas = &renderer->draw_context.canvas;
+
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplSDL3_NewFrame();
   igNewFrame();
@@ -189,7 +329,9 @@ void imgui_render(AppState *app_state, Canvas *canvas, ImGuiIO *io) {
   igPushStyleVar_Vec2(ImGuiStyleVar_WindowPadding, (ImVec2){0, 0});
   igPushStyleVar_Float(ImGuiStyleVar_WindowBorderSize, 0.0f);
   igBegin("Background", NULL, flags);
-  // igImage((ImTextureID)(intptr_t)renderer->texture, (ImVec2){(float)app_state->width, (float)app_state->height}, (ImVec2){0, 1}, (ImVec2){1, 0});
+  igImage((ImTextureID)(intptr_t)renderer->texture, (ImVec2){canvas->width, canvas->height}, (ImVec2){0, 0},
+          (ImVec2){canvas->resolution_scale, canvas->resolution_scale});
+  draw_picking_overlay(app_state, world, canvas);
   igEnd();
   igPopStyleVar(2);
 
@@ -208,10 +350,76 @@ void imgui_render(AppState *app_state, Canvas *canvas, ImGuiIO *io) {
     igText("Frame time %.2f ms/frame", 1000.0f / igGetIO()->Framerate);
     igSeparator();
 
+    if (renderer->last_damage_rects == 0) {
+      igText("Surface: idle, frame skipped");
+    } else if (renderer->drawn_aggregate) {
+      igText("Surface: density overview");
+    } else {
+      igText("Surface: %d dirty rect(s), %d line(s) drawn", renderer->last_damage_rects, renderer->last_visible_lines);
+    }
+    igText("Lines indexed: %u", renderer->line_index.line_count);
+    ResolutionController *resolution = &renderer->resolution;
+    igCheckbox("Dynamic resolution", &resolution->enabled);
+    if (resolution->enabled) {
+      igSliderFloat("Budget (ms)", &resolution->budget_ms, 1.0f, 33.0f, "%.1f", 0);
+      igText("Resolution: %.0f%%, render %.2f ms", canvas->resolution_scale * 100.0f, resolution->last_ms);
+      if (renderer->pipeline || renderer->use_tile_cache) {
+        igText("Full resolution with the render thread or tile cache");
+      }
+    }
+    bool tile_cache = renderer->use_tile_cache;
+    if (igCheckbox("Tile cache", &tile_cache)) {
+      renderer_set_tile_cache(renderer, tile_cache);
+    }
+    if (renderer->use_tile_cache) {
+      const TileCache *cache = &renderer->tile_cache;
+      igText("Tiles: %u reused, %u drawn, %u scaled", cache->reused, cache->drawn, cache->scaled);
+    }
+    bool pipelined = renderer->pipeline != NULL;
+    if (igCheckbox("Pipelined render thread", &pipelined)) {
+      renderer_set_pipelined(renderer, pipelined);
+    }
+    if (renderer->pipeline) {
+      igText("Presenting one frame behind, PBO ring unused");
+    } else if (renderer->ring_available) {
+      bool use_ring = renderer->use_ring;
+      if (igCheckbox("PBO upload ring", &use_ring)) {
+        renderer_set_upload_ring(renderer, use_ring);
+      }
+      if (renderer->use_ring) {
+        igText("Upload latency: %.2f ms (%s)", renderer->ring.latency_ms, renderer->ring.persistent ? "persistent" : "mapped per frame");
+      }
+    } else {
+      igText("PBO upload ring unavailable");
+    }
+    bool picking = renderer->draw_context.surface.ids != NULL;
+    if (igCheckbox("Picking", &picking)) {
+      renderer_set_picking(renderer, picking);
+    }
+    if (picking) {
+      igText("Hovered: %llu, %u selected", (unsigned long long)app_state->hovered, app_state->picked.count);
+    }
+    igSeparator();
+
     igText("Canvas Zoom: %.2f", canvas->scale);
     igText("Canvas Position: [%.1f, %.1f]", canvas->position[0], canvas->position[1]);
     igSeparator();
 
+    igText("Rasterizer");
+    int raster_mode = rasterizer_get_mode(&renderer->draw_context.surface);
+    igRadioButton_IntPtr("Scanline", &raster_mode, RASTER_MODE_SCANLINE);
+    igSameLine(0.0f, -1.0f);
+    igRadioButton_IntPtr("Half-space", &raster_mode, RASTER_MODE_HALFSPACE);
+    igSameLine(0.0f, -1.0f);
+    igRadioButton_IntPtr("Anti-aliased", &raster_mode, RASTER_MODE_ANALYTIC_AA);
+    renderer_set_mode(renderer, raster_mode);
+    igSeparator();
+
+#ifdef PROFILER_ENABLED
+    imgui_profiler_panel();
+    igSeparator();
+#endif
+
     // Line data
     // Line *line = &app_state->line;
     // igText("Line world pos: [%.1f, %.1f]", line->transform.position[0], line->transform.position[1]);
@@ -228,7 +436,7 @@ void imgui_render(AppState *app_state, Canvas *canvas, ImGuiIO *io) {
           .b = bg_color[2],
           .a = bg_color[3],
       };
-      // renderer_set_clear_color(renderer, bg_colorf);
+      renderer_set_clear_color(renderer, bg_colorf);
     }
 
     igEnd();
@@ -237,7 +445,7 @@ void imgui_render(AppState *app_state, Canvas *canvas, ImGuiIO *io) {
   igRender();
 }
 
-int main() {
+int main(int argc, char **argv) {
   if (SDL_Init(SDL_INIT_VIDEO) == 0) {
     SDL_Log("SDL_Init failed: %s", SDL_GetError());
     return -1;
@@ -265,12 +473,27 @@ int main() {
   // Setup world
   // ecs_log_set_level(1);
   ecs_world_t *world = ecs_init();
+  // One thread per core for the whole frame, both sets count the main thread. The flecs
+  // workers run the line systems in PreStore and the rasterizer pool draws in OnStore, so
+  // they take turns. The render thread and the tile cache draw through the same pool.
+  uint32_t threads = thread_pool_cpu_count();
+  ecs_set_threads(world, (int32_t)threads);
 
   // Register component types
   ECS_COMPONENT_DEFINE(world, AppState);
   ECS_COMPONENT_DEFINE(world, ResizeParams);
   ECS_COMPONENT_DEFINE(world, Canvas);
   ECS_COMPONENT_DEFINE(world, Surface);
+  ECS_COMPONENT_DEFINE(world, Position);
+  ECS_COMPONENT_DEFINE(world, Line);
+  ECS_COMPONENT_DEFINE(world, LineBounds);
+  ECS_COMPONENT_DEFINE(world, ScreenLine);
+  ECS_COMPONENT_DEFINE(world, LineQuads);
+  ECS_COMPONENT_DEFINE(world, Polyline);
+  ECS_COMPONENT_DEFINE(world, PolylineStroke);
+  ECS_COMPONENT_DEFINE(world, Selected);
+  ECS_COMPONENT_DEFINE(world, SoftwareOpenGlRenderer);
+  components_set_hooks(world);
 
   // Setup app
   AppState app_state = {.running = true, .show_debug = true};
@@ -278,19 +501,71 @@ int main() {
   printf("AAAAAA\n");
 
   // Set singletons
+  SoftwareOpenGlRenderer renderer_state = renderer_create(WIDTH, HEIGHT, threads);
+  renderer_state.polyline_query = ecs_query(world, {.terms = {{ecs_id(PolylineStroke), .inout = EcsIn},
+                                                              {ecs_id(Polyline), .inout = EcsIn},
+                                                              {ecs_id(Position), .inout = EcsIn},
+                                                              {ecs_id(LineBounds), .inout = EcsIn}}});
+  renderer_state.highlight_query = ecs_query(world, {.terms = {{ecs_id(LineQuads), .inout = EcsIn}, {ecs_id(Selected), .inout = EcsInOutNone}}});
+  ecs_singleton_set_ptr(world, SoftwareOpenGlRenderer, &renderer_state);
 
   // Observers
   // ecs_observer(world, {.query.terms = {{ecs_id(ResizeParams)}, {ecs_id(Canvas)}}, .events = {EcsOnSet}, .callback = renderer_resize_system});
   // ecs_observer(world, {.query.terms = {{ecs_id(ResizeParams), .src.id = 0}, {ecs_id(Canvas), .src.id = 0}},
   //                      .events = {EcsOnSet},
   //                      .callback = renderer_resize_system});
+  ecs_observer(world, {.query.terms = {{ecs_id(Line)}, {ecs_id(Position)}}, .events = {EcsOnSet, EcsOnRemove}, .callback = line_bounds_observer});
+  ecs_observer(world,
+               {.query.terms = {{ecs_id(Polyline)}, {ecs_id(Position)}}, .events = {EcsOnSet, EcsOnRemove}, .callback = polyline_bounds_observer});
+
+  // Every Line carries its bounds and the per-frame output of the line systems, so setting
+  // them never moves the entity to another table
+  ecs_add_pair(world, ecs_id(Line), EcsWith, ecs_id(LineBounds));
+  ecs_add_pair(world, ecs_id(Line), EcsWith, ecs_id(ScreenLine));
+  ecs_add_pair(world, ecs_id(Line), EcsWith, ecs_id(LineQuads));
+  ecs_add_pair(world, ecs_id(Polyline), EcsWith, ecs_id(LineBounds));
+  ecs_add_pair(world, ecs_id(Polyline), EcsWith, ecs_id(PolylineStroke));
 
   // Systems
-  ecs_entity_t surface_resize_s = ecs_system(
-      world, {.entity = ecs_entity(world, {.name = "ManualSystem"}), .query.terms = {{ecs_id(Surface)}}, .callback = surface_resize_system});
-
-  // Initial data
-  ecs_set(world, ecs_id(Surface), Surface, {0});
+  ecs_entity_t surface_resize_s = ecs_system(world, {.entity = ecs_entity(world, {.name = "ManualSystem"}),
+                                                     .query.terms = {{ecs_id(SoftwareOpenGlRenderer), .src.id = ecs_id(SoftwareOpenGlRenderer)}},
+                                                     .callback = surface_resize_system});
+  // PostUpdate: pick what to redraw, PreStore: per line work on the flecs workers, OnStore: rasterize and upload
+  ecs_system(world, {.entity = ecs_entity(world, {.name = "RenderPrepareSystem", .add = ecs_ids(ecs_dependson(EcsPostUpdate))}),
+                     .query.terms = {{ecs_id(SoftwareOpenGlRenderer), .src.id = ecs_id(SoftwareOpenGlRenderer)}},
+                     .run = render_prepare_system});
+  ecs_system(world, {.entity = ecs_entity(world, {.name = "LineTransformSystem", .add = ecs_ids(ecs_dependson(EcsPreStore))}),
+                     .query.terms = {{ecs_id(Line), .inout = EcsIn},
+                                     {ecs_id(Position), .inout = EcsIn},
+                                     {ecs_id(LineBounds), .inout = EcsIn},
+                                     {ecs_id(ScreenLine), .inout = EcsOut},
+                                     {ecs_id(SoftwareOpenGlRenderer), .src.id = ecs_id(SoftwareOpenGlRenderer), .inout = EcsIn}},
+                     .callback = line_transform_system,
+                     .multi_threaded = true});
+  ecs_system(world, {.entity = ecs_entity(world, {.name = "LineTessellateSystem", .add = ecs_ids(ecs_dependson(EcsPreStore))}),
+                     .query.terms = {{ecs_id(ScreenLine), .inout = EcsIn},
+                                     {ecs_id(LineQuads), .inout = EcsOut},
+                                     {ecs_id(SoftwareOpenGlRenderer), .src.id = ecs_id(SoftwareOpenGlRenderer), .inout = EcsIn}},
+                     .callback = line_tessellate_system,
+                     .multi_threaded = true});
+  ecs_system(world, {.entity = ecs_entity(world, {.name = "PolylineTessellateSystem", .add = ecs_ids(ecs_dependson(EcsPreStore))}),
+                     .query.terms = {{ecs_id(Polyline), .inout = EcsIn},
+                                     {ecs_id(Position), .inout = EcsIn},
+                                     {ecs_id(LineBounds), .inout = EcsIn},
+                                     {ecs_id(PolylineStroke), .inout = EcsOut},
+                                     {ecs_id(SoftwareOpenGlRenderer), .src.id = ecs_id(SoftwareOpenGlRenderer), .inout = EcsIn}},
+                     .callback = polyline_tessellate_system,
+                     .multi_threaded = true});
+  ecs_system(world, {.entity = ecs_entity(world, {.name = "RenderSystem", .add = ecs_ids(ecs_dependson(EcsOnStore))}),
+                     .query.terms = {{ecs_id(SoftwareOpenGlRenderer), .src.id = ecs_id(SoftwareOpenGlRenderer)}},
+                     .run = render_system});
+
+  // Initial data, streamed in while the loop runs
+  SceneStream *scene_stream = NULL;
+  uint64_t scene_stream_start = clock_now_ns();
+  if (argc > 1 && !(scene_stream = scene_stream_open(argv[1]))) {
+    SDL_Log("Failed to load scene %s", argv[1]);
+  }
 
   // Initial setup
   ResizeParams resize_params = {.width = WIDTH, .height = HEIGHT};
@@ -300,30 +575,73 @@ int main() {
   // renderer_set_clear_color(&renderer, (ColorF){0});
 
   while (app_state.running) {
+    PROFILE_BEGIN("handle_input");
     handle_input(&app_state, world, surface_resize_s);
+    PROFILE_END();
+
+    if (scene_stream) {
+      PROFILE_BEGIN("scene_stream");
+      // Lines around the viewport center arrive first
+      Canvas *canvas = &ecs_singleton_get_mut(world, SoftwareOpenGlRenderer)->draw_context.canvas;
+      vec2 center;
+      canvas_screen_to_world(canvas, (vec2){canvas->width * 0.5f, canvas->height * 0.5f}, center);
+      scene_stream_set_focus(scene_stream, center);
+      scene_stream_pump(scene_stream, world, SCENE_STREAM_FRAME_BUDGET_NS);
+      if (scene_stream_done(scene_stream)) {
+        uint64_t inserted, total;
+        scene_stream_progress(scene_stream, &inserted, &total);
+        SDL_Log("Loaded %s, %llu lines in %.1f ms", argv[1], (unsigned long long)total, (clock_now_ns() - scene_stream_start) / 1e6);
+        scene_stream_destroy(scene_stream);
+        scene_stream = NULL;
+      }
+      PROFILE_END();
+    }
+
+    // Custom renderer, runs RenderSystem
+    PROFILE_BEGIN("ecs_progress");
+    ecs_progress(world, 0.0f);
+    PROFILE_END();
 
-    // Custom renderer
-    // renderer_render(&renderer, app_state.world, line_transform_q);
+    // Picks from the frame just drawn
+    SoftwareOpenGlRenderer *renderer = ecs_singleton_get_mut(world, SoftwareOpenGlRenderer);
+    bool over_ui = io->WantCaptureMouse && !app_state.selecting;
+    vec2 pixel;
+    canvas_screen_to_surface(&renderer->draw_context.canvas, app_state.mouse, pixel);
+    app_state.hovered = over_ui ? 0 : picking_entity_at(world, &renderer->draw_context.surface, (int)floorf(pixel[0]), (int)floorf(pixel[1]));
 
     // Render ui
-    // imgui_render(&app_state, &renderer, io);
+    PROFILE_BEGIN("imgui");
+    imgui_render(&app_state, world, renderer, io);
+    PROFILE_END();
 
     // Opengl render
-    // glViewport(0, 0, (int)io->DisplaySize.x, (int)io->DisplaySize.y);
-    // glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-    // glClear(GL_COLOR_BUFFER_BIT);
-    //
-    // ImGui_ImplOpenGL3_RenderDrawData(igGetDrawData());
+    PROFILE_BEGIN("gl_draw");
+    glViewport(0, 0, (int)io->DisplaySize.x, (int)io->DisplaySize.y);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    ImGui_ImplOpenGL3_RenderDrawData(igGetDrawData());
+    PROFILE_END();
+
+    PROFILE_BEGIN("swap");
     SDL_GL_SwapWindow(window);
+    PROFILE_END();
+    PROFILE_FRAME_MARK();
   }
 
   // Cleanup
+  scene_stream_destroy(scene_stream);
+  renderer_free(ecs_singleton_get_mut(world, SoftwareOpenGlRenderer));
+  pick_set_free(&app_state.picked);
   ecs_fini(world);
 
-  // ImGui_ImplOpenGL3_Shutdown();
-  // ImGui_ImplSDL3_Shutdown();
-  // igDestroyContext(NULL);
-  // renderer_free(&renderer);
+#ifdef PROFILER_ENABLED
+  profiler_shutdown();
+#endif
+
+  ImGui_ImplOpenGL3_Shutdown();
+  ImGui_ImplSDL3_Shutdown();
+  igDestroyContext(NULL);
   SDL_DestroyWindow(window);
   SDL_Quit();
   printf("End\n");
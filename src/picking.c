@@ -0,0 +1,87 @@
+#include "picking.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PICK_SET_MIN_SLOTS 64
+
+static inline uint32_t id_hash(uint32_t id) { return (uint32_t)(((uint64_t)id * 0x9E3779B97F4A7C15ull) >> 32); }
+
+// True when the id was not in yet
+static bool insert_slot(uint32_t *slots, uint32_t capacity, uint32_t id) {
+  uint32_t mask = capacity - 1;
+  uint32_t i = id_hash(id) & mask;
+  while (slots[i] && slots[i] != id) {
+    i = (i + 1) & mask;
+  }
+  bool added = slots[i] == RASTERIZER_NO_ID;
+  slots[i] = id;
+  return added;
+}
+
+// Keeps the load factor at most one half, ids counts the ones already in
+static void reserve_slots(PickSet *set, uint32_t ids) {
+  if ((ids + 1) * 2 <= set->slot_capacity)
+    return;
+
+  uint32_t capacity = set->slot_capacity ? set->slot_capacity * 2 : PICK_SET_MIN_SLOTS;
+  uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+  for (uint32_t i = 0; i < set->slot_capacity; i++) {
+    if (set->slots[i]) {
+      insert_slot(slots, capacity, set->slots[i]);
+    }
+  }
+  free(set->slots);
+  set->slots = slots;
+  set->slot_capacity = capacity;
+}
+
+void pick_set_free(PickSet *set) {
+  free(set->entities);
+  free(set->slots);
+  *set = (PickSet){0};
+}
+
+ecs_entity_t picking_entity_at(ecs_world_t *world, const Surface *surface, int x, int y) {
+  if (!surface->ids || x < 0 || y < 0 || (uint32_t)x >= surface->width || (uint32_t)y >= surface->height)
+    return 0;
+  uint32_t id = surface->ids[(size_t)y * surface->width + x];
+  return id == RASTERIZER_NO_ID ? 0 : ecs_get_alive(world, id);
+}
+
+uint32_t picking_entities_in_rect(ecs_world_t *world, const Surface *surface, Rect rect, PickSet *set) {
+  set->count = 0;
+  if (set->slots) {
+    memset(set->slots, 0, set->slot_capacity * sizeof(uint32_t));
+  }
+  rect = rect_intersect(rect, rasterizer_surface_rect(surface));
+  if (!surface->ids || rect_is_empty(rect))
+    return 0;
+
+  // Neighbouring pixels mostly belong to the same line, only changes go to the set
+  uint32_t ids = 0;
+  for (int y = rect.y0; y < rect.y1; y++) {
+    const uint32_t *row = &surface->ids[(size_t)y * surface->width];
+    uint32_t last = RASTERIZER_NO_ID;
+    for (int x = rect.x0; x < rect.x1; x++) {
+      uint32_t id = row[x];
+      if (id == last || id == RASTERIZER_NO_ID)
+        continue;
+      last = id;
+      reserve_slots(set, ids);
+      ids += insert_slot(set->slots, set->slot_capacity, id);
+    }
+  }
+
+  if (ids > set->capacity) {
+    set->capacity = ids;
+    set->entities = realloc(set->entities, set->capacity * sizeof(ecs_entity_t));
+  }
+  for (uint32_t i = 0; i < set->slot_capacity; i++) {
+    ecs_entity_t entity = set->slots[i] ? ecs_get_alive(world, set->slots[i]) : 0;
+    if (entity) {
+      set->entities[set->count++] = entity;
+    }
+  }
+  return set->count;
+}
@@ -0,0 +1,29 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include "flecs.h"
+#include "graphics/rasterizer.h"
+#include <stdint.h>
+
+// Reads the surface's id plane, a pixel holds the low 32 bits of the entity drawn on top of it.
+// The plane shows the last frame drawn, entities deleted since resolve to nothing.
+
+// Entities found inside a rect, each once. Reused across picks.
+typedef struct {
+  ecs_entity_t *entities;
+  uint32_t count;
+  uint32_t capacity;
+
+  // Open addressing over the ids seen, RASTERIZER_NO_ID is empty
+  uint32_t *slots;
+  uint32_t slot_capacity;
+} PickSet;
+
+void pick_set_free(PickSet *set);
+
+// Entity at the pixel, 0 when there is none or the surface has no ids
+ecs_entity_t picking_entity_at(ecs_world_t *world, const Surface *surface, int x, int y);
+// Entities with a pixel inside rect, replacing the contents of set. Returns set->count.
+uint32_t picking_entities_in_rect(ecs_world_t *world, const Surface *surface, Rect rect, PickSet *set);
+
+#endif // PICKING_H
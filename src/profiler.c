@@ -0,0 +1,191 @@
+#include "profiler.h"
+
+#ifdef PROFILER_ENABLED
+
+#include "clock.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#define PROFILER_AVERAGE_WEIGHT 0.1f
+
+typedef struct {
+  ProfilerEvent events[PROFILER_RING_SIZE];
+  // Only the owning thread writes events, readers load head with acquire
+  _Atomic uint64_t head;
+  uint64_t read; // Folded into the stats up to here, main thread only
+
+  uint64_t stack_start[PROFILER_MAX_DEPTH];
+  const char *stack_name[PROFILER_MAX_DEPTH];
+  uint32_t depth;
+  uint32_t id;
+} ProfilerThread;
+
+static _Atomic(ProfilerThread *) threads[PROFILER_MAX_THREADS];
+static atomic_uint thread_count;
+static _Thread_local ProfilerThread *local_thread;
+
+static ProfilerStats stats;
+static float zone_history[PROFILER_MAX_ZONES][PROFILER_HISTORY];
+static uint64_t last_mark_ns;
+static uint64_t epoch_ns;
+static once_flag epoch_once = ONCE_FLAG_INIT;
+
+static void set_epoch(void) { epoch_ns = clock_now_ns(); }
+
+// Set by whichever thread records or exports first, every thread sees the same one
+static uint64_t epoch(void) {
+  call_once(&epoch_once, set_epoch);
+  return epoch_ns;
+}
+
+static ProfilerThread *current_thread(void) {
+  if (local_thread)
+    return local_thread;
+
+  epoch();
+  uint32_t id = atomic_fetch_add(&thread_count, 1);
+  if (id >= PROFILER_MAX_THREADS)
+    return NULL;
+  ProfilerThread *thread = calloc(1, sizeof(ProfilerThread));
+  thread->id = id;
+  atomic_store(&threads[id], thread);
+  local_thread = thread;
+  return thread;
+}
+
+void profiler_begin(const char *name) {
+  ProfilerThread *thread = current_thread();
+  if (!thread)
+    return;
+
+  // Deeper zones are not recorded but still balanced
+  if (thread->depth < PROFILER_MAX_DEPTH) {
+    thread->stack_name[thread->depth] = name;
+    thread->stack_start[thread->depth] = clock_now_ns();
+  }
+  thread->depth++;
+}
+
+void profiler_end(void) {
+  ProfilerThread *thread = local_thread;
+  if (!thread || thread->depth == 0)
+    return;
+
+  uint32_t depth = --thread->depth;
+  if (depth >= PROFILER_MAX_DEPTH)
+    return;
+
+  uint64_t head = atomic_load_explicit(&thread->head, memory_order_relaxed);
+  thread->events[head & (PROFILER_RING_SIZE - 1)] = (ProfilerEvent){
+      .name = thread->stack_name[depth],
+      .start_ns = thread->stack_start[depth],
+      .end_ns = clock_now_ns(),
+      .depth = depth,
+  };
+  atomic_store_explicit(&thread->head, head + 1, memory_order_release);
+}
+
+static int find_zone(const char *name) {
+  for (int i = 0; i < stats.zone_count; i++) {
+    if (stats.zones[i].name == name || strcmp(stats.zones[i].name, name) == 0)
+      return i;
+  }
+  if (stats.zone_count == PROFILER_MAX_ZONES)
+    return -1;
+
+  int zone = stats.zone_count++;
+  stats.zones[zone] = (ProfilerZoneStats){.name = name};
+  return zone;
+}
+
+void profiler_frame_mark(void) {
+  uint64_t now = clock_now_ns();
+  float frame_ms = last_mark_ns ? (float)(now - last_mark_ns) / 1.0e6f : 0.0f;
+  last_mark_ns = now;
+
+  double zone_ms[PROFILER_MAX_ZONES] = {0};
+  uint32_t zone_calls[PROFILER_MAX_ZONES] = {0};
+
+  uint32_t count = atomic_load(&thread_count);
+  count = count < PROFILER_MAX_THREADS ? count : PROFILER_MAX_THREADS;
+  for (uint32_t t = 0; t < count; t++) {
+    ProfilerThread *thread = atomic_load(&threads[t]);
+    if (!thread)
+      continue;
+
+    uint64_t head = atomic_load_explicit(&thread->head, memory_order_acquire);
+    uint64_t from = head - thread->read > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : thread->read;
+    for (uint64_t i = from; i < head; i++) {
+      const ProfilerEvent *event = &thread->events[i & (PROFILER_RING_SIZE - 1)];
+      int zone = find_zone(event->name);
+      if (zone >= 0) {
+        zone_ms[zone] += (double)(event->end_ns - event->start_ns) / 1.0e6;
+        zone_calls[zone]++;
+      }
+    }
+    thread->read = head;
+  }
+
+  int slot = stats.history_head;
+  stats.frame_ms[slot] = frame_ms;
+  stats.last_frame_ms = frame_ms;
+  stats.history_head = (slot + 1) % PROFILER_HISTORY;
+
+  for (int z = 0; z < stats.zone_count; z++) {
+    ProfilerZoneStats *zone = &stats.zones[z];
+    zone->last_ms = (float)zone_ms[z];
+    zone->calls = zone_calls[z];
+    zone->average_ms += (zone->last_ms - zone->average_ms) * PROFILER_AVERAGE_WEIGHT;
+
+    zone_history[z][slot] = zone->last_ms;
+    zone->max_ms = 0.0f;
+    for (int i = 0; i < PROFILER_HISTORY; i++) {
+      zone->max_ms = zone_history[z][i] > zone->max_ms ? zone_history[z][i] : zone->max_ms;
+    }
+  }
+}
+
+const ProfilerStats *profiler_stats(void) { return &stats; }
+
+bool profiler_dump_chrome_trace(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (!file)
+    return false;
+
+  fprintf(file, "{\"traceEvents\":[\n");
+  uint64_t epoch_start = epoch();
+  bool first = true;
+  uint32_t count = atomic_load(&thread_count);
+  count = count < PROFILER_MAX_THREADS ? count : PROFILER_MAX_THREADS;
+  for (uint32_t t = 0; t < count; t++) {
+    ProfilerThread *thread = atomic_load(&threads[t]);
+    if (!thread)
+      continue;
+
+    uint64_t head = atomic_load_explicit(&thread->head, memory_order_acquire);
+    uint64_t from = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+    for (uint64_t i = from; i < head; i++) {
+      const ProfilerEvent *event = &thread->events[i & (PROFILER_RING_SIZE - 1)];
+      // Complete events, timestamps in microseconds
+      fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n", event->name, thread->id,
+              (double)(int64_t)(event->start_ns - epoch_start) / 1000.0, (double)(event->end_ns - event->start_ns) / 1000.0);
+      first = false;
+    }
+  }
+  fprintf(file, "\n]}\n");
+  return fclose(file) == 0;
+}
+
+void profiler_shutdown(void) {
+  uint32_t count = atomic_exchange(&thread_count, 0);
+  count = count < PROFILER_MAX_THREADS ? count : PROFILER_MAX_THREADS;
+  for (uint32_t t = 0; t < count; t++) {
+    free(atomic_exchange(&threads[t], NULL));
+  }
+  local_thread = NULL;
+}
+
+#endif // PROFILER_ENABLED
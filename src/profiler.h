@@ -0,0 +1,69 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Scoped zones timed into a ring buffer per thread. Without PROFILER_ENABLED
+// (the ENABLE_PROFILER CMake option) every macro compiles to nothing.
+//
+//   PROFILE_BEGIN("clear");
+//   ...
+//   PROFILE_END();
+//
+// Zone names must be string literals or otherwise outlive the profiler.
+
+#define PROFILER_RING_SIZE (1 << 16) // Events per thread, power of two
+#define PROFILER_MAX_THREADS 64
+#define PROFILER_MAX_DEPTH 32
+#define PROFILER_MAX_ZONES 64
+#define PROFILER_HISTORY 240 // Frames kept for the graph
+
+typedef struct {
+  const char *name;
+  uint64_t start_ns;
+  uint64_t end_ns;
+  uint32_t depth;
+} ProfilerEvent;
+
+// Aggregated over every thread, workers add their busy time
+typedef struct {
+  const char *name;
+  float last_ms;
+  float average_ms; // Exponential moving average
+  float max_ms;     // Over the frames in the history
+  uint32_t calls;   // Last frame
+} ProfilerZoneStats;
+
+typedef struct {
+  ProfilerZoneStats zones[PROFILER_MAX_ZONES];
+  int zone_count;
+  float frame_ms[PROFILER_HISTORY]; // Ring, frame_ms[history_head] is the oldest
+  int history_head;
+  float last_frame_ms;
+} ProfilerStats;
+
+#ifdef PROFILER_ENABLED
+
+void profiler_begin(const char *name);
+void profiler_end(void);
+// Closes the frame on the calling thread and folds the new events into the stats
+void profiler_frame_mark(void);
+const ProfilerStats *profiler_stats(void);
+// Writes every event still in the rings as Chrome trace_event JSON
+bool profiler_dump_chrome_trace(const char *path);
+void profiler_shutdown(void);
+
+#define PROFILE_BEGIN(name) profiler_begin(name)
+#define PROFILE_END() profiler_end()
+#define PROFILE_FRAME_MARK() profiler_frame_mark()
+
+#else
+
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END() ((void)0)
+#define PROFILE_FRAME_MARK() ((void)0)
+
+#endif // PROFILER_ENABLED
+
+#endif // PROFILER_H
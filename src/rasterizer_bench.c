@@ -0,0 +1,613 @@
+// Headless rasterizer benchmark, prints one JSON object per workload:
+//   rasterizer_bench [--quick] [--filter <substring>] [--check]
+// Pixel counts are the covered area estimated from the geometry, clipped to
+// the surface, so megapixels per second compare across workloads. --check
+// only verifies the stroke coverage the polyline workloads rely on and the
+// placement of thin lines reaching far off the surface.
+
+#include "canvas.h"
+#include "clock.h"
+#include "drawer.h"
+#include "graphics/blend.h"
+#include "graphics/density.h"
+#include "graphics/fill.h"
+#include "graphics/rasterizer.h"
+#include "graphics/stroke.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_MAX_SAMPLES 64
+#define BENCH_PI 3.14159265f
+
+typedef enum {
+  ORIENTATION_HORIZONTAL,
+  ORIENTATION_VERTICAL,
+  ORIENTATION_DIAGONAL,
+  ORIENTATION_RANDOM,
+  ORIENTATION_COUNT,
+} Orientation;
+
+static const char *orientation_names[ORIENTATION_COUNT] = {"horizontal", "vertical", "diagonal", "random"};
+static const char *mode_names[] = {"scanline", "halfspace", "analytic_aa"};
+
+typedef struct {
+  int warmup;
+  int samples;
+  const char *filter;
+} BenchConfig;
+
+// One workload: geometry generated up front, draw() replays all of it
+typedef struct {
+  char name[256];
+  Surface *surface;
+  int prim_count;
+  double pixels;
+  void (*draw)(void *ctx);
+  void *ctx;
+} Workload;
+
+typedef struct {
+  Surface *surface;
+  float (*lines)[4];
+  int count;
+  float thickness;
+  DrawContext *draw_context;
+} LineCtx;
+
+typedef struct {
+  Surface *surface;
+  int (*spans)[3];
+  int count;
+  FillFn blend; // Blend span kernel, spans are drawn with draw_span when NULL
+} SpanCtx;
+
+typedef struct {
+  Surface *surface;
+  Point (*triangles)[3];
+  int count;
+} TriangleCtx;
+
+static uint32_t rng_state = 0x12345678u;
+
+// xorshift, the workloads must not change between runs
+static float random_unit(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return (rng_state >> 8) * (1.0f / 16777216.0f);
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, double p) {
+  double rank = p * (count - 1);
+  int lo = (int)rank;
+  int hi = lo + 1 < count ? lo + 1 : lo;
+  return sorted[lo] + (sorted[hi] - sorted[lo]) * (rank - lo);
+}
+
+static void run_workload(const BenchConfig *config, const Workload *workload) {
+  if (config->filter && !strstr(workload->name, config->filter))
+    return;
+
+  for (int i = 0; i < config->warmup; i++) {
+    workload->draw(workload->ctx);
+  }
+
+  double ns[BENCH_MAX_SAMPLES];
+  double total = 0.0;
+  for (int i = 0; i < config->samples; i++) {
+    uint64_t start = clock_now_ns();
+    workload->draw(workload->ctx);
+    ns[i] = (double)(clock_now_ns() - start);
+    total += ns[i];
+  }
+  qsort(ns, config->samples, sizeof(double), compare_double);
+
+  double per_prim = 1.0 / workload->prim_count;
+  double median = percentile(ns, config->samples, 0.5);
+  printf("{%s, \"prims\": %d, \"pixels\": %.0f, \"samples\": %d, "
+         "\"ns_per_prim\": %.2f, \"ns_per_prim_min\": %.2f, \"ns_per_prim_mean\": %.2f, "
+         "\"ns_per_prim_p90\": %.2f, \"ns_per_prim_p99\": %.2f, \"mpix_per_s\": %.2f}\n",
+         workload->name, workload->prim_count, workload->pixels, config->samples, median * per_prim, ns[0] * per_prim,
+         total / config->samples * per_prim, percentile(ns, config->samples, 0.9) * per_prim, percentile(ns, config->samples, 0.99) * per_prim,
+         workload->pixels / median * 1000.0);
+  fflush(stdout);
+}
+
+// Clip to the surface the same way the rasterizers do, for the pixel estimate
+static float clipped_length(const Surface *surface, const float line[4]) {
+  float x0 = line[0], y0 = line[1], dx = line[2] - line[0], dy = line[3] - line[1];
+  float p[4] = {-dx, dx, -dy, dy};
+  float q[4] = {x0, surface->width - x0, y0, surface->height - y0};
+  float t0 = 0.0f, t1 = 1.0f;
+  for (int i = 0; i < 4; i++) {
+    if (p[i] == 0.0f) {
+      if (q[i] < 0.0f)
+        return 0.0f;
+      continue;
+    }
+    float t = q[i] / p[i];
+    if (p[i] < 0.0f) {
+      t0 = t > t0 ? t : t0;
+    } else {
+      t1 = t < t1 ? t : t1;
+    }
+  }
+  return t1 > t0 ? (t1 - t0) * sqrtf(dx * dx + dy * dy) : 0.0f;
+}
+
+// Lines centered on screen, or spread over three times the surface so most are clipped
+static void generate_lines(const Surface *surface, float (*lines)[4], int count, Orientation orientation, float length, int clipped) {
+  float spread = clipped ? 3.0f : 1.0f;
+  for (int i = 0; i < count; i++) {
+    float cx = surface->width * (0.5f + (random_unit() - 0.5f) * spread);
+    float cy = surface->height * (0.5f + (random_unit() - 0.5f) * spread);
+    float angle = 0.0f;
+    switch (orientation) {
+    case ORIENTATION_HORIZONTAL:
+      angle = 0.0f;
+      break;
+    case ORIENTATION_VERTICAL:
+      angle = BENCH_PI * 0.5f;
+      break;
+    case ORIENTATION_DIAGONAL:
+      angle = BENCH_PI * 0.25f;
+      break;
+    default:
+      angle = random_unit() * BENCH_PI;
+      break;
+    }
+    float hx = cosf(angle) * length * 0.5f, hy = sinf(angle) * length * 0.5f;
+    lines[i][0] = cx - hx;
+    lines[i][1] = cy - hy;
+    lines[i][2] = cx + hx;
+    lines[i][3] = cy + hy;
+  }
+}
+
+static void draw_clear(void *ctx) { rasterizer_clear_surface(ctx); }
+
+static void draw_spans(void *ctx) {
+  SpanCtx *spans = ctx;
+  for (int i = 0; i < spans->count; i++) {
+    draw_span(spans->surface, spans->spans[i][0], spans->spans[i][1], spans->spans[i][2], 0xff3366ccu);
+  }
+}
+
+// Half transparent, premultiplied
+static void draw_blend_spans(void *ctx) {
+  SpanCtx *spans = ctx;
+  Surface *surface = spans->surface;
+  for (int i = 0; i < spans->count; i++) {
+    int *span = spans->spans[i];
+    spans->blend(&surface->buffer[(size_t)span[0] * surface->width + span[1]], 0x801a3366u, span[2] - span[1] + 1);
+  }
+}
+
+static void draw_triangles(void *ctx) {
+  TriangleCtx *triangles = ctx;
+  for (int i = 0; i < triangles->count; i++) {
+    Point *v = triangles->triangles[i];
+    draw_filled_triangle(triangles->surface, v[0], v[1], v[2], 0xff3366ccu);
+  }
+}
+
+static void draw_thick_lines(void *ctx) {
+  LineCtx *lines = ctx;
+  ColorF color = {.r = 0.2f, .g = 0.4f, .b = 0.8f, .a = 1.0f};
+  for (int i = 0; i < lines->count; i++) {
+    Point p0 = {(int)lines->lines[i][0], (int)lines->lines[i][1]};
+    Point p1 = {(int)lines->lines[i][2], (int)lines->lines[i][3]};
+    rasterizer_draw_thick_line(lines->surface, p0, p1, (int)lines->thickness, color);
+  }
+}
+
+// Canvas transform, culling, command recording and the batched flush
+static void draw_context_lines_bench(void *ctx) {
+  LineCtx *lines = ctx;
+  DrawContext *draw_context = lines->draw_context;
+  draw_context_begin(draw_context);
+  draw_context_set_color(draw_context, (ColorF){.r = 0.2f, .g = 0.4f, .b = 0.8f, .a = 1.0f});
+  for (int i = 0; i < lines->count; i++) {
+    draw_context_line(draw_context, lines->lines[i], &lines->lines[i][2], lines->thickness);
+  }
+  draw_context_flush(draw_context);
+}
+
+typedef struct {
+  Surface *surface;
+  float (*lines)[4];
+  int count;
+  DensityBuffer *density;
+} DensityCtx;
+
+// The whole aggregated frame: clear the counts, add every line, tone map
+static void draw_density(void *ctx) {
+  DensityCtx *density = ctx;
+  density_clear(density->density);
+  for (int i = 0; i < density->count; i++) {
+    density_add_line(density->density, density->lines[i], &density->lines[i][2]);
+  }
+  density_tone_map(density->density, density->surface, rasterizer_surface_rect(density->surface));
+}
+
+typedef struct {
+  Surface *surface;
+  vec2 *points;
+  int count;
+  StrokeStyle style;
+} PolylineCtx;
+
+// Tessellation, setup and rasterization of the whole path
+static void draw_polyline(void *ctx) {
+  PolylineCtx *polyline = ctx;
+  ColorF color = {.r = 0.2f, .g = 0.4f, .b = 0.8f, .a = 1.0f};
+  stroke_draw_polyline(polyline->surface, polyline->points, polyline->count, &polyline->style, color);
+}
+
+// The same path as one thick line per segment
+static void draw_polyline_segments(void *ctx) {
+  PolylineCtx *polyline = ctx;
+  ColorF color = {.r = 0.2f, .g = 0.4f, .b = 0.8f, .a = 1.0f};
+  for (int i = 1; i < polyline->count; i++) {
+    rasterizer_draw_line(polyline->surface, polyline->points[i - 1], polyline->points[i], polyline->style.width, color);
+  }
+}
+
+static Surface surface_create(uint32_t width, uint32_t height) {
+  Surface surface = {0};
+  rasterizer_surface_resize(&surface, width, height);
+  rasterizer_clear_surface(&surface);
+  return surface;
+}
+
+static void bench_clear(const BenchConfig *config) {
+  static const uint32_t sizes[][2] = {{640, 480}, {1920, 1080}, {3840, 2160}};
+  for (int s = 0; s < 3; s++) {
+    Surface surface = surface_create(sizes[s][0], sizes[s][1]);
+    Workload workload = {.surface = &surface, .prim_count = 1, .pixels = (double)surface.width * surface.height, .draw = draw_clear, .ctx = &surface};
+    snprintf(workload.name, sizeof(workload.name), "\"bench\": \"clear\", \"surface\": \"%ux%u\"", surface.width, surface.height);
+    run_workload(config, &workload);
+    rasterizer_surface_free(&surface);
+  }
+}
+
+static void bench_spans(const BenchConfig *config, Surface *surface, int count) {
+  static const int lengths[] = {4, 32, 256, 1500};
+  int(*spans)[3] = malloc(count * sizeof(*spans));
+  for (int l = 0; l < 4; l++) {
+    int length = lengths[l] < (int)surface->width ? lengths[l] : (int)surface->width;
+    double pixels = 0.0;
+    for (int i = 0; i < count; i++) {
+      int x0 = (int)(random_unit() * (surface->width - length));
+      spans[i][0] = (int)(random_unit() * surface->height);
+      spans[i][1] = x0;
+      spans[i][2] = x0 + length - 1;
+      pixels += length;
+    }
+    SpanCtx ctx = {surface, spans, count, NULL};
+    Workload workload = {.surface = surface, .prim_count = count, .pixels = pixels, .draw = draw_spans, .ctx = &ctx};
+    snprintf(workload.name, sizeof(workload.name), "\"bench\": \"span\", \"surface\": \"%ux%u\", \"length\": %d", surface->width,
+             surface->height, length);
+    run_workload(config, &workload);
+
+    // Same spans through every blend kernel, replace is the fill above
+    static const char *format_names[PIXEL_FORMAT_COUNT] = {"xrgb", "argb"};
+    Workload blend = workload;
+    blend.draw = draw_blend_spans;
+    for (int mode = BLEND_MODE_SOURCE_OVER; mode < BLEND_MODE_COUNT; mode++) {
+      for (int format = 0; format < PIXEL_FORMAT_COUNT; format++) {
+        ctx.blend = blend_span((BlendMode)mode, (PixelFormat)format);
+        snprintf(blend.name, sizeof(blend.name), "\"bench\": \"blend_span\", \"surface\": \"%ux%u\", \"length\": %d, \"blend\": \"%s\", \"format\": \"%s\"",
+                 surface->width, surface->height, length, blend_mode_name((BlendMode)mode), format_names[format]);
+        run_workload(config, &blend);
+      }
+    }
+  }
+  free(spans);
+}
+
+static void bench_triangles(const BenchConfig *config, Surface *surface, int count) {
+  static const float sizes[] = {8.0f, 64.0f, 512.0f};
+  Point(*triangles)[3] = malloc(count * sizeof(*triangles));
+  for (int s = 0; s < 3; s++) {
+    for (int clipped = 0; clipped < 2; clipped++) {
+      double pixels = 0.0;
+      float spread = clipped ? 3.0f : 1.0f;
+      for (int i = 0; i < count; i++) {
+        float cx = surface->width * (0.5f + (random_unit() - 0.5f) * spread);
+        float cy = surface->height * (0.5f + (random_unit() - 0.5f) * spread);
+        for (int k = 0; k < 3; k++) {
+          float angle = random_unit() * 2.0f * BENCH_PI;
+          triangles[i][k] = (Point){(int)(cx + cosf(angle) * sizes[s]), (int)(cy + sinf(angle) * sizes[s])};
+        }
+        Point *v = triangles[i];
+        double area = fabs((double)(v[1].x - v[0].x) * (v[2].y - v[0].y) - (double)(v[2].x - v[0].x) * (v[1].y - v[0].y)) * 0.5;
+        // Fraction of the circumscribed box on screen, close enough for a rate
+        float visible_x = fminf(cx + sizes[s], (float)surface->width) - fmaxf(cx - sizes[s], 0.0f);
+        float visible_y = fminf(cy + sizes[s], (float)surface->height) - fmaxf(cy - sizes[s], 0.0f);
+        if (visible_x > 0.0f && visible_y > 0.0f) {
+          pixels += area * (visible_x * visible_y) / (4.0f * sizes[s] * sizes[s]);
+        }
+      }
+      TriangleCtx ctx = {surface, triangles, count};
+      Workload workload = {.surface = surface, .prim_count = count, .pixels = pixels, .draw = draw_triangles, .ctx = &ctx};
+      snprintf(workload.name, sizeof(workload.name), "\"bench\": \"triangle\", \"surface\": \"%ux%u\", \"size\": %.0f, \"clipped\": %s",
+               surface->width, surface->height, sizes[s], clipped ? "true" : "false");
+      run_workload(config, &workload);
+    }
+  }
+  free(triangles);
+}
+
+static void bench_lines(const BenchConfig *config, Surface *surface, int count) {
+  static const float thicknesses[] = {1.0f, 2.0f, 8.0f, 32.0f};
+  float(*lines)[4] = malloc(count * sizeof(*lines));
+
+  DrawContext draw_context = {.surface = *surface};
+  canvas_init(&draw_context.canvas, surface->width, surface->height);
+  // Identity on screen: canvas_transform_point adds the center back
+  canvas_translate(&draw_context.canvas, surface->width * 0.5f, surface->height * 0.5f);
+
+  for (int t = 0; t < 4; t++) {
+    for (int o = 0; o < ORIENTATION_COUNT; o++) {
+      for (int clipped = 0; clipped < 2; clipped++) {
+        generate_lines(surface, lines, count, o, 200.0f, clipped);
+        double pixels = 0.0;
+        for (int i = 0; i < count; i++) {
+          pixels += clipped_length(surface, lines[i]) * thicknesses[t];
+        }
+
+        LineCtx ctx = {surface, lines, count, thicknesses[t], &draw_context};
+        Workload workload = {.surface = surface, .prim_count = count, .pixels = pixels, .draw = draw_thick_lines, .ctx = &ctx};
+        char params[128];
+        snprintf(params, sizeof(params), "\"surface\": \"%ux%u\", \"thickness\": %.0f, \"orientation\": \"%s\", \"clipped\": %s",
+                 surface->width, surface->height, thicknesses[t], orientation_names[o], clipped ? "true" : "false");
+        snprintf(workload.name, sizeof(workload.name), "\"bench\": \"thick_line\", %s", params);
+        run_workload(config, &workload);
+
+        workload.draw = draw_context_lines_bench;
+        for (int mode = RASTER_MODE_SCANLINE; mode <= RASTER_MODE_ANALYTIC_AA; mode++) {
+          rasterizer_set_mode(&draw_context.surface, mode);
+          snprintf(workload.name, sizeof(workload.name), "\"bench\": \"draw_context_line\", \"mode\": \"%s\", %s", mode_names[mode], params);
+          run_workload(config, &workload);
+        }
+      }
+    }
+  }
+
+  draw_context_free(&draw_context);
+  free(lines);
+}
+
+// Zoomed out overviews: many sub-pixel lines, aggregated against drawn as strokes
+static void bench_density(const BenchConfig *config, Surface *surface, int count) {
+  static const float lengths[] = {0.5f, 4.0f};
+  float(*lines)[4] = malloc(count * sizeof(*lines));
+
+  DensityBuffer density = {0};
+  density_resize(&density, surface->width, surface->height);
+  density_set_ramp(&density, (ColorF){.r = 0.68f, .g = 0.85f, .b = 1.0f, .a = 1.0f}, (ColorF){.r = 0.0f, .g = 0.0f, .b = 0.55f, .a = 1.0f});
+  DrawContext draw_context = {.surface = *surface};
+  canvas_init(&draw_context.canvas, surface->width, surface->height);
+  canvas_translate(&draw_context.canvas, surface->width * 0.5f, surface->height * 0.5f);
+
+  for (int l = 0; l < 2; l++) {
+    generate_lines(surface, lines, count, ORIENTATION_RANDOM, lengths[l], 0);
+    char params[128];
+    snprintf(params, sizeof(params), "\"surface\": \"%ux%u\", \"length\": %.1f", surface->width, surface->height, lengths[l]);
+
+    DensityCtx density_ctx = {surface, lines, count, &density};
+    Workload workload = {.surface = surface, .prim_count = count, .pixels = count * fmaxf(lengths[l], 1.0f), .draw = draw_density, .ctx = &density_ctx};
+    snprintf(workload.name, sizeof(workload.name), "\"bench\": \"density\", %s", params);
+    run_workload(config, &workload);
+
+    LineCtx line_ctx = {surface, lines, count, 0.5f, &draw_context};
+    workload.draw = draw_context_lines_bench;
+    workload.ctx = &line_ctx;
+    snprintf(workload.name, sizeof(workload.name), "\"bench\": \"draw_context_line\", \"mode\": \"scanline\", \"thickness\": 0.5, %s", params);
+    run_workload(config, &workload);
+  }
+
+  draw_context_free(&draw_context);
+  density_free(&density);
+  free(lines);
+}
+
+// Random walk kept on the surface, a trace with many short segments
+static void bench_polyline(const BenchConfig *config, Surface *surface, int count) {
+  static const StrokeJoin joins[] = {STROKE_JOIN_MITER, STROKE_JOIN_BEVEL, STROKE_JOIN_ROUND};
+  static const char *join_names[] = {"miter", "bevel", "round"};
+  vec2 *points = malloc(count * sizeof(vec2));
+  float x = surface->width * 0.5f, y = surface->height * 0.5f, heading = 0.0f, length = 0.0f;
+  for (int i = 0; i < count; i++) {
+    heading += (random_unit() - 0.5f) * BENCH_PI * 0.5f;
+    float step = 2.0f + random_unit() * 6.0f;
+    float nx = x + cosf(heading) * step, ny = y + sinf(heading) * step;
+    if (nx < 0.0f || ny < 0.0f || nx >= surface->width || ny >= surface->height) {
+      heading += BENCH_PI;
+      nx = x;
+      ny = y;
+    }
+    length += fabsf(nx - x) + fabsf(ny - y);
+    x = nx;
+    y = ny;
+    points[i][0] = x;
+    points[i][1] = y;
+  }
+
+  for (int j = 0; j < 3; j++) {
+    PolylineCtx ctx = {surface, points, count, {.width = 6.0f, .join = joins[j], .cap = STROKE_CAP_ROUND, .miter_limit = 4.0f}};
+    Workload workload = {.surface = surface, .prim_count = count, .pixels = length * ctx.style.width, .draw = draw_polyline, .ctx = &ctx};
+    snprintf(workload.name, sizeof(workload.name), "\"bench\": \"polyline\", \"join\": \"%s\", \"surface\": \"%ux%u\", \"vertices\": %d",
+             join_names[j], surface->width, surface->height, count);
+    run_workload(config, &workload);
+  }
+
+  Surface halfspace = *surface;
+  rasterizer_set_mode(&halfspace, RASTER_MODE_HALFSPACE);
+  PolylineCtx ctx = {&halfspace, points, count, {.width = 6.0f}};
+  Workload workload = {.surface = surface, .prim_count = count, .pixels = length * ctx.style.width, .draw = draw_polyline_segments, .ctx = &ctx};
+  snprintf(workload.name, sizeof(workload.name), "\"bench\": \"polyline_segments\", \"surface\": \"%ux%u\", \"vertices\": %d", surface->width,
+           surface->height, count);
+  run_workload(config, &workload);
+  free(points);
+}
+
+// Distance from q to the segment ab, t is where q projects onto it in pixels
+static float segment_distance(const float *q, const float *a, const float *b, float *t) {
+  float dx = b[0] - a[0], dy = b[1] - a[1];
+  float length = sqrtf(dx * dx + dy * dy);
+  *t = ((q[0] - a[0]) * dx + (q[1] - a[1]) * dy) / length;
+  float u = fminf(fmaxf(*t / length, 0.0f), 1.0f);
+  float ex = a[0] + u * dx - q[0], ey = a[1] + u * dy - q[1];
+  return sqrtf(ex * ex + ey * ey);
+}
+
+// Counts the writes per pixel of one butt-capped stroke by adding 1 per triangle.
+// Pixels well inside a segment must be written, and no pixel more often than the
+// segments around it, or max_writes where the path doubles back over itself.
+static bool check_stroke(const char *name, const vec2 *points, int count, float width, StrokeJoin join, int max_writes) {
+  Surface surface = surface_create(200, 120);
+  memset(surface.buffer, 0, (size_t)surface.width * surface.height * sizeof(uint32_t));
+  StrokeStyle style = {.width = width, .join = join, .cap = STROKE_CAP_BUTT, .miter_limit = 4.0f};
+  StrokeStrip strip = {0};
+  stroke_tessellate(&strip, points, count, &style);
+  RasterPrim *prims = malloc((strip.count ? strip.count : 1) * sizeof(RasterPrim));
+  int prim_count = stroke_setup_prims(&strip, 0, BLEND_MODE_REPLACE, prims);
+  rasterizer_blend_prims(prims, prim_count, BLEND_MODE_ADD, 0x00000001u);
+  rasterizer_draw_prims(&surface, rasterizer_surface_rect(&surface), prims, prim_count);
+
+  int gaps = 0, overdrawn = 0;
+  float half_w = width * 0.5f;
+  for (uint32_t y = 0; y < surface.height; y++) {
+    for (uint32_t x = 0; x < surface.width; x++) {
+      int writes = (int)(surface.buffer[y * surface.width + x] & 0xff);
+      vec2 q = {x + 0.5f, y + 0.5f};
+      bool inside = false;
+      int near = 0;
+      for (int i = 0; i + 1 < count; i++) {
+        float t;
+        float d = segment_distance(q, points[i], points[i + 1], &t);
+        float length = hypotf(points[i + 1][0] - points[i][0], points[i + 1][1] - points[i][1]);
+        inside |= d < half_w - 1.0f && t > 1.0f && t < length - 1.0f;
+        near += d < half_w + 1.0f;
+      }
+      gaps += inside && writes == 0;
+      overdrawn += writes > (near < 1 ? 1 : (near < max_writes ? near : max_writes));
+    }
+  }
+  bool ok = gaps == 0 && overdrawn == 0;
+  printf("{\"check\": \"stroke_coverage\", \"path\": \"%s\", \"join\": %d, \"gaps\": %d, \"overdrawn\": %d, \"ok\": %s}\n", name, join, gaps,
+         overdrawn, ok ? "true" : "false");
+  free(prims);
+  stroke_strip_free(&strip);
+  rasterizer_surface_free(&surface);
+  return ok;
+}
+
+// Acute, reversing and short-segment paths, only a path doubling back may cover a pixel twice
+static bool check_strokes(void) {
+  static const vec2 near_reversal[] = {{10, 20}, {100, 21}, {20, 24}};
+  static const vec2 full_reversal[] = {{30, 20}, {100, 20}, {60, 20}};
+  static const vec2 acute[] = {{10, 20}, {150, 25}, {60, 100}};
+  static const vec2 right_angles[] = {{20, 20}, {150, 20}, {150, 100}, {30, 100}};
+  static const vec2 zigzag[] = {{20, 60}, {26, 40}, {32, 60}, {38, 40}, {44, 60}, {140, 50}};
+  bool ok = true;
+  for (int join = STROKE_JOIN_MITER; join <= STROKE_JOIN_ROUND; join++) {
+    ok &= check_stroke("near_reversal", near_reversal, 3, 16.0f, join, 2);
+    ok &= check_stroke("full_reversal", full_reversal, 3, 16.0f, join, 2);
+    ok &= check_stroke("acute", acute, 3, 12.0f, join, 1);
+    ok &= check_stroke("right_angles", right_angles, 4, 10.0f, join, 1);
+    ok &= check_stroke("zigzag", zigzag, 6, 10.0f, join, 2);
+  }
+  return ok;
+}
+
+// A thin line from far off the surface must still draw each pixel within half a
+// pixel of the exact centerline, the minor axis step is long enough for it.
+static bool check_far_line(const char *name, const float *p0, const float *p1) {
+  Surface surface = surface_create(200, 120);
+  memset(surface.buffer, 0, (size_t)surface.width * surface.height * sizeof(uint32_t));
+  vec2 a = {p0[0], p0[1]}, b = {p1[0], p1[1]};
+  RasterPrim prims[2];
+  int prim_count = rasterizer_setup_line(&surface, a, b, 1.0f, 0xffffffffu, prims);
+  rasterizer_draw_prims(&surface, rasterizer_surface_rect(&surface), prims, prim_count);
+
+  bool x_major = fabsf(b[0] - a[0]) >= fabsf(b[1] - a[1]);
+  double slope = x_major ? ((double)b[1] - a[1]) / ((double)b[0] - a[0]) : ((double)b[0] - a[0]) / ((double)b[1] - a[1]);
+  int steps = x_major ? (int)surface.width : (int)surface.height;
+  int minors = x_major ? (int)surface.height : (int)surface.width;
+  int drawn = 0;
+  double worst = 0.0;
+  for (int i = 0; i < steps; i++) {
+    double exact = x_major ? a[1] + (i + 0.5 - a[0]) * slope : a[0] + (i + 0.5 - a[1]) * slope;
+    for (int m = 0; m < minors; m++) {
+      uint32_t pixel = x_major ? surface.buffer[m * surface.width + i] : surface.buffer[i * surface.width + m];
+      if (pixel) {
+        drawn++;
+        worst = fmax(worst, fabs(m + 0.5 - exact));
+      }
+    }
+  }
+  bool ok = drawn > 0 && worst <= 0.5 + 1.0 / 64.0;
+  printf("{\"check\": \"far_line\", \"line\": \"%s\", \"drawn\": %d, \"max_error\": %.3f, \"ok\": %s}\n", name, drawn, worst,
+         ok ? "true" : "false");
+  rasterizer_surface_free(&surface);
+  return ok;
+}
+
+// Lines with an end millions of pixels away, trimmed to the setup window
+static bool check_far_lines(void) {
+  static const vec2 far[][2] = {
+      {{-4000000.0f, -1333000.0f}, {500.0f, 200.0f}},
+      {{-1200000.0f, -3900000.0f}, {150.0f, 110.0f}},
+      {{-3000000.0f, -1000000.0f}, {3000000.0f, 1000060.0f}},
+  };
+  static const char *names[] = {"x_major", "y_major", "both_ends"};
+  bool ok = true;
+  for (int i = 0; i < 3; i++) {
+    ok &= check_far_line(names[i], far[i][0], far[i][1]);
+  }
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  BenchConfig config = {.warmup = 2, .samples = 25};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) {
+      config.warmup = 1;
+      config.samples = 5;
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      config.filter = argv[++i];
+    } else if (strcmp(argv[i], "--check") == 0) {
+      bool ok = check_strokes();
+      ok &= check_far_lines();
+      return ok ? 0 : 1;
+    } else {
+      fprintf(stderr, "usage: %s [--quick] [--filter <substring>] [--check]\n", argv[0]);
+      return 1;
+    }
+  }
+  fprintf(stderr, "fill kernel: %s\n", fill_kernel_name(fill_active_kernel()));
+
+  bench_clear(&config);
+
+  static const uint32_t sizes[][2] = {{640, 480}, {1920, 1080}};
+  for (int s = 0; s < 2; s++) {
+    Surface surface = surface_create(sizes[s][0], sizes[s][1]);
+    bench_spans(&config, &surface, 100000);
+    bench_triangles(&config, &surface, 10000);
+    bench_lines(&config, &surface, 10000);
+    bench_density(&config, &surface, 1000000);
+    bench_polyline(&config, &surface, 100000);
+    rasterizer_surface_free(&surface);
+  }
+  return 0;
+}
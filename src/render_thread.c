@@ -0,0 +1,212 @@
+#include "render_thread.h"
+#include "drawer.h"
+#include "graphics/tile_rasterizer.h"
+#include "profiler.h"
+#include "spsc_queue.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <threads.h>
+
+struct RenderThread {
+  thrd_t thread;
+  RenderJob jobs[RENDER_THREAD_SURFACES];
+
+  // Job indices, main -> render and render -> main
+  SpscQueue submitted;
+  SpscQueue completed;
+
+  // Only for sleeping, the queues themselves are lock-free
+  mtx_t lock;
+  cnd_t wake;
+  cnd_t done;
+  atomic_bool quit;
+
+  // Render thread only
+  RenderScratch scratch;
+  TileRasterizer *tiler;
+
+  // Main thread only
+  bool held[RENDER_THREAD_SURFACES];
+  bool in_flight;
+  uint64_t frame;
+};
+
+void render_job_add_polyline(RenderJob *job, const vec2 *points, uint32_t count, const vec2 offset, const StrokeStyle *style) {
+  if (job->point_count + count > job->point_capacity) {
+    job->point_capacity = job->point_count + count > job->point_capacity * 2 ? job->point_count + count : job->point_capacity * 2;
+    job->points = realloc(job->points, job->point_capacity * sizeof(vec2));
+  }
+  if (job->polyline_count == job->polyline_capacity) {
+    job->polyline_capacity = job->polyline_capacity ? job->polyline_capacity * 2 : 64;
+    job->polylines = realloc(job->polylines, job->polyline_capacity * sizeof(RenderPolyline));
+  }
+
+  job->polylines[job->polyline_count++] = (RenderPolyline){.first = job->point_count, .count = count, .style = *style};
+  vec2 *out = job->points + job->point_count;
+  for (uint32_t i = 0; i < count; i++) {
+    out[i][0] = points[i][0] + offset[0];
+    out[i][1] = points[i][1] + offset[1];
+  }
+  job->point_count += count;
+}
+
+void render_scratch_free(RenderScratch *scratch) {
+  stroke_strip_free(&scratch->strip);
+  free(scratch->prims);
+  draw_context_free(&scratch->draw_context);
+  *scratch = (RenderScratch){0};
+}
+
+static void render_polylines(RenderScratch *scratch, RenderJob *job) {
+  DrawContext *ctx = &scratch->draw_context;
+  for (uint32_t i = 0; i < job->point_count; i++) {
+    canvas_transform_point(&job->canvas, job->points[i], job->points[i]);
+  }
+
+  for (uint32_t i = 0; i < job->polyline_count; i++) {
+    const RenderPolyline *polyline = &job->polylines[i];
+    stroke_tessellate(&scratch->strip, job->points + polyline->first, (int)polyline->count, &polyline->style);
+    if (scratch->strip.count > scratch->prim_capacity) {
+      scratch->prim_capacity = scratch->strip.count;
+      scratch->prims = realloc(scratch->prims, scratch->prim_capacity * sizeof(RasterPrim));
+    }
+    int count = stroke_setup_prims(&scratch->strip, ctx->color, ctx->blend, scratch->prims);
+    draw_context_draw_prims(ctx, scratch->prims, count);
+  }
+}
+
+void render_job_draw(RenderJob *job, RenderScratch *scratch, TileRasterizer *tiler) {
+  DrawContext *ctx = &scratch->draw_context;
+  ctx->canvas = job->canvas;
+  ctx->surface = job->surface;
+  ctx->tiler = tiler;
+
+  rasterizer_clear_surface(&ctx->surface);
+  draw_context_set_clips(ctx, NULL, 0);
+  draw_context_begin(ctx);
+  draw_context_set_color(ctx, job->color);
+  render_polylines(scratch, job);
+  draw_context_lines(ctx, &job->lines, job->thickness);
+  draw_context_flush(ctx);
+}
+
+static void render_job(RenderThread *rt, RenderJob *job) {
+  PROFILE_BEGIN("render_job");
+  rasterizer_surface_resize(&job->surface, canvas_surface_width(&job->canvas), canvas_surface_height(&job->canvas));
+  render_job_draw(job, &rt->scratch, job->tiled ? rt->tiler : NULL);
+  PROFILE_END();
+}
+
+static int render_thread_main(void *arg) {
+  RenderThread *rt = arg;
+
+  for (;;) {
+    uint32_t index;
+    if (!spsc_queue_pop(&rt->submitted, &index)) {
+      mtx_lock(&rt->lock);
+      while (!atomic_load(&rt->quit) && spsc_queue_empty(&rt->submitted)) {
+        cnd_wait(&rt->wake, &rt->lock);
+      }
+      mtx_unlock(&rt->lock);
+      if (atomic_load(&rt->quit))
+        return 0;
+      continue;
+    }
+
+    render_job(rt, &rt->jobs[index]);
+    spsc_queue_push(&rt->completed, index);
+
+    mtx_lock(&rt->lock);
+    cnd_signal(&rt->done);
+    mtx_unlock(&rt->lock);
+  }
+}
+
+RenderThread *render_thread_create(ThreadPool *pool) {
+  RenderThread *rt = calloc(1, sizeof(RenderThread));
+  spsc_queue_init(&rt->submitted);
+  spsc_queue_init(&rt->completed);
+  mtx_init(&rt->lock, mtx_plain);
+  cnd_init(&rt->wake);
+  cnd_init(&rt->done);
+  atomic_init(&rt->quit, false);
+  rt->tiler = tile_rasterizer_create(pool);
+
+  if (thrd_create(&rt->thread, render_thread_main, rt) != thrd_success) {
+    tile_rasterizer_free(rt->tiler);
+    cnd_destroy(&rt->wake);
+    cnd_destroy(&rt->done);
+    mtx_destroy(&rt->lock);
+    free(rt);
+    return NULL;
+  }
+  return rt;
+}
+
+void render_thread_destroy(RenderThread *rt) {
+  if (!rt)
+    return;
+
+  // Whatever is in flight finishes first
+  mtx_lock(&rt->lock);
+  atomic_store(&rt->quit, true);
+  cnd_signal(&rt->wake);
+  mtx_unlock(&rt->lock);
+  thrd_join(rt->thread, NULL);
+
+  for (int i = 0; i < RENDER_THREAD_SURFACES; i++) {
+    rasterizer_surface_free(&rt->jobs[i].surface);
+    line_batch_free(&rt->jobs[i].lines);
+    free(rt->jobs[i].points);
+    free(rt->jobs[i].polylines);
+  }
+  render_scratch_free(&rt->scratch);
+  tile_rasterizer_free(rt->tiler);
+  cnd_destroy(&rt->wake);
+  cnd_destroy(&rt->done);
+  mtx_destroy(&rt->lock);
+  free(rt);
+}
+
+RenderJob *render_thread_acquire(RenderThread *rt) {
+  if (rt->in_flight)
+    return NULL;
+  for (int i = 0; i < RENDER_THREAD_SURFACES; i++) {
+    if (!rt->held[i]) {
+      rt->held[i] = true;
+      return &rt->jobs[i];
+    }
+  }
+  return NULL;
+}
+
+void render_thread_submit(RenderThread *rt, RenderJob *job) {
+  uint32_t index = (uint32_t)(job - rt->jobs);
+  job->frame = ++rt->frame;
+  rt->in_flight = true;
+  spsc_queue_push(&rt->submitted, index);
+
+  mtx_lock(&rt->lock);
+  cnd_signal(&rt->wake);
+  mtx_unlock(&rt->lock);
+}
+
+RenderJob *render_thread_poll(RenderThread *rt) {
+  uint32_t index;
+  if (!spsc_queue_pop(&rt->completed, &index))
+    return NULL;
+  rt->in_flight = false;
+  return &rt->jobs[index];
+}
+
+void render_thread_release(RenderThread *rt, RenderJob *job) { rt->held[job - rt->jobs] = false; }
+
+void render_thread_wait(RenderThread *rt) {
+  if (!rt->in_flight)
+    return;
+  mtx_lock(&rt->lock);
+  while (spsc_queue_empty(&rt->completed)) {
+    cnd_wait(&rt->done, &rt->lock);
+  }
+  mtx_unlock(&rt->lock);
+}
@@ -0,0 +1,76 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include "canvas.h"
+#include "drawer.h"
+#include "graphics/rasterizer.h"
+#include "graphics/stroke.h"
+#include "thread_pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// One surface is rendered while the other one is uploaded, so frames are
+// at most one behind the main thread
+#define RENDER_THREAD_SURFACES 2
+
+// A stroked path of a job, its points are points[first, first + count)
+typedef struct {
+  uint32_t first;
+  uint32_t count;
+  StrokeStyle style; // Screen-space width
+} RenderPolyline;
+
+// Snapshot of everything a frame needs. Owned by the main thread until
+// submitted and again once polled, by the render thread in between.
+typedef struct {
+  Canvas canvas;
+  LineBatch lines; // World space, transformed in place by the render thread
+  float thickness;
+  // World space, drawn under the lines
+  vec2 *points;
+  uint32_t point_count;
+  uint32_t point_capacity;
+  RenderPolyline *polylines;
+  uint32_t polyline_count;
+  uint32_t polyline_capacity;
+  ColorF color;
+  bool tiled;
+  uint64_t frame;
+
+  // Resized to the canvas by the render thread, its state is set by the main thread
+  Surface surface;
+} RenderJob;
+
+// Copies the path offset by offset, style is already in screen space
+void render_job_add_polyline(RenderJob *job, const vec2 *points, uint32_t count, const vec2 offset, const StrokeStyle *style);
+
+// What a thread needs to draw jobs, reused across them
+typedef struct {
+  DrawContext draw_context;
+  StrokeStrip strip;
+  RasterPrim *prims;
+  uint32_t prim_capacity;
+} RenderScratch;
+
+void render_scratch_free(RenderScratch *scratch);
+
+// Clears the job's surface and draws its polylines, then its lines. The surface must already
+// be sized, its origin places it among the canvas pixels. Bins on tiler when one is given.
+void render_job_draw(RenderJob *job, RenderScratch *scratch, TileRasterizer *tiler);
+
+typedef struct RenderThread RenderThread;
+
+// Tiled jobs run on pool, nothing else may use it while the thread is alive
+RenderThread *render_thread_create(ThreadPool *pool);
+void render_thread_destroy(RenderThread *rt);
+
+// Main thread side. A job to fill, NULL while the previous one is still rendering.
+RenderJob *render_thread_acquire(RenderThread *rt);
+void render_thread_submit(RenderThread *rt, RenderJob *job);
+// The finished frame or NULL, hand it back with render_thread_release once uploaded
+RenderJob *render_thread_poll(RenderThread *rt);
+void render_thread_release(RenderThread *rt, RenderJob *job);
+// Blocks until the submitted job is done, it is still returned by the next poll
+void render_thread_wait(RenderThread *rt);
+
+#endif // RENDER_THREAD_H
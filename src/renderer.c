@@ -4,30 +4,47 @@
 #include "SDL3/SDL_opengl.h"
 #include "canvas.h"
 #include "cglm/types.h"
+#include "clock.h"
 #include "components.h"
 #include "drawer.h"
+#include "graphics/density.h"
 #include "graphics/rasterizer.h"
+#include "graphics/stroke.h"
 #include "input.h"
+#include "profiler.h"
+#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Far out, lines are counted per pixel instead of drawn once strokes are thinner
+// than this and lines are shorter than that on average, in pixels
+#define DENSITY_MAX_STROKE 1.0f
+#define DENSITY_MAX_MEAN_LENGTH 8.0f
+// Tiles drawn per frame while the zoom keeps changing, the rest show a cached zoom scaled
+#define TILE_ZOOM_JOBS 4
 
 // Private
 void update_texture(GLuint texture, const Surface *surface) {
   glBindTexture(GL_TEXTURE_2D, texture);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, surface->width, surface->height, GL_RGBA, GL_UNSIGNED_BYTE, surface->buffer);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, surface->width, surface->height, GL_BGRA, GL_UNSIGNED_BYTE, surface->buffer);
 }
 
-void resize_surface(Surface *surface, uint32_t width, uint32_t height) {
-  if (surface->buffer) {
-    free(surface->buffer);
+// Uploads only the given sub-rects of the surface
+void update_texture_rects(GLuint texture, const Surface *surface, const Rect *rects, int count) {
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, surface->width);
+  for (int i = 0; i < count; i++) {
+    Rect r = rects[i];
+    const uint32_t *pixels = &surface->buffer[(size_t)r.y0 * surface->width + r.x0];
+    glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0, GL_BGRA, GL_UNSIGNED_BYTE, pixels);
   }
-  surface->width = width;
-  surface->height = height;
-  surface->buffer = malloc(width * height * sizeof(uint32_t));
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 }
 
-GLuint create_texture_from_surface(const Surface *surface) {
+// Screen sized, a surface drawn at a lower resolution fills its top left corner
+GLuint create_texture(uint32_t width, uint32_t height) {
   GLuint texture;
   glGenTextures(1, &texture);
   glBindTexture(GL_TEXTURE_2D, texture);
@@ -35,50 +52,810 @@ GLuint create_texture_from_surface(const Surface *surface) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Prevent blurring
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_BGRA, surface->width, surface->height, 0, GL_BGRA, GL_UNSIGNED_BYTE, surface->buffer);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
   return texture;
 }
+
+// Surface pixels a world-space box can touch with the current canvas
+static Rect screen_rect_from_world(Canvas *canvas, const LineBounds *bounds) {
+  vec2 min, max;
+  canvas_transform_point(canvas, (float *)bounds->min, min);
+  canvas_transform_point(canvas, (float *)bounds->max, max);
+
+  // Rounding in the rasterizers and the thin line runs stay within 2px
+  return (Rect){
+      (int)floorf(fminf(min[0], max[0])) - 2,
+      (int)floorf(fminf(min[1], max[1])) - 2,
+      (int)ceilf(fmaxf(min[0], max[0])) + 2,
+      (int)ceilf(fmaxf(min[1], max[1])) + 2,
+  };
+}
+
+// World-space box covering the surface rect, the canvas may be rotated
+static void world_box_from_screen(Canvas *canvas, Rect rect, vec2 min, vec2 max) {
+  vec2 corners[4] = {
+      {(float)rect.x0, (float)rect.y0},
+      {(float)rect.x1, (float)rect.y0},
+      {(float)rect.x0, (float)rect.y1},
+      {(float)rect.x1, (float)rect.y1},
+  };
+  glm_vec2_fill(min, INFINITY);
+  glm_vec2_fill(max, -INFINITY);
+  for (int i = 0; i < 4; i++) {
+    vec2 world;
+    canvas_surface_to_world(canvas, corners[i], world);
+    glm_vec2_minv(min, world, min);
+    glm_vec2_maxv(max, world, max);
+  }
+}
+
+static bool bounds_overlap(const LineBounds *bounds, const vec2 min, const vec2 max) {
+  return bounds->max[0] >= min[0] && bounds->min[0] <= max[0] && bounds->max[1] >= min[1] && bounds->min[1] <= max[1];
+}
+
+static void batch_indexed_line(void *ctx, const LineIndexEntry *entry) { line_batch_push(ctx, entry->a, entry->b); }
+
+// Where an entity was or is now: redrawn this frame and stale in the cached tiles of every zoom.
+// Scene loads call this per line, the tile scan returns at once while no tile is valid.
+static void damage_bounds(SoftwareOpenGlRenderer *renderer, const LineBounds *bounds) {
+  damage_add(&renderer->damage, screen_rect_from_world(&renderer->draw_context.canvas, bounds));
+  tile_cache_invalidate(&renderer->tile_cache, bounds->min, bounds->max);
+}
+
+static bool canvas_changed(SoftwareOpenGlRenderer *renderer) {
+  Canvas *canvas = &renderer->draw_context.canvas;
+  return renderer->drawn_version != canvas->version || renderer->drawn_mode != rasterizer_get_mode(&renderer->draw_context.surface);
+}
+// Lines are counted into the density buffer instead of drawn at this zoom
+static bool wants_aggregate(SoftwareOpenGlRenderer *renderer) {
+  float scale = canvas_pixel_scale(&renderer->draw_context.canvas);
+  float stroke = LINE_THICKNESS * scale;
+  float mean_length = line_index_mean_extent(&renderer->line_index) * scale;
+  return stroke < DENSITY_MAX_STROKE && mean_length < DENSITY_MAX_MEAN_LENGTH;
+}
+
+// The density overview is normalized over the whole view, it never goes through the tile cache
+static bool use_tile_path(SoftwareOpenGlRenderer *renderer) { return renderer->use_tile_cache && !wants_aggregate(renderer); }
+// Nor through the render thread, whose jobs only hold strokes
+static bool use_pipeline(SoftwareOpenGlRenderer *renderer) { return renderer->pipeline && !wants_aggregate(renderer); }
+
+// Sizes the surface and the upload ring after the canvas, the texture keeps the screen size
+static void resize_surface(SoftwareOpenGlRenderer *renderer) {
+  Canvas *canvas = &renderer->draw_context.canvas;
+  uint32_t width = canvas_surface_width(canvas), height = canvas_surface_height(canvas);
+  rasterizer_surface_resize(&renderer->draw_context.surface, width, height);
+  damage_add_full(&renderer->damage);
+
+  if (renderer->ring_available) {
+    upload_ring_free(&renderer->ring);
+    renderer->ring_available = upload_ring_init(&renderer->ring, width, height);
+    renderer->use_ring = renderer->use_ring && renderer->ring_available;
+  }
+}
+
+// Only the direct path draws below full resolution, the render thread and the
+// tile cache are measured on other threads or over many frames
+static void apply_resolution(SoftwareOpenGlRenderer *renderer, bool direct) {
+  Canvas *canvas = &renderer->draw_context.canvas;
+  float scale = direct ? renderer->resolution.scale : 1.0f;
+  if (scale == canvas->resolution_scale)
+    return;
+  canvas_set_resolution_scale(canvas, scale);
+  resize_surface(renderer);
+}
 // End Private
 
 // Public implementations
 void surface_resize_system(ecs_iter_t *it) {
   printf("Resized!\n");
 
-  Surface *surface = ecs_field(it, Surface, 0);
+  PROFILE_BEGIN("surface_resize_system");
+  SoftwareOpenGlRenderer *renderer = ecs_field(it, SoftwareOpenGlRenderer, 0);
   ResizeParams *resize_params = (ResizeParams *)it->param;
 
-  resize_surface(surface, resize_params->width, resize_params->height);
+  renderer_handle_resize(renderer, resize_params->width, resize_params->height);
+  PROFILE_END();
+}
+
+// OnSet / OnRemove of Line and Position: damages where the line was and where it is now, moves it in the index
+void line_bounds_observer(ecs_iter_t *it) {
+  SoftwareOpenGlRenderer *renderer = ecs_singleton_get_mut(it->world, SoftwareOpenGlRenderer);
+  if (!renderer)
+    return;
+
+  PROFILE_BEGIN("line_bounds_observer");
+  Line *line = ecs_field(it, Line, 0);
+  Position *position = ecs_field(it, Position, 1);
+
+  for (int i = 0; i < it->count; i++) {
+    LineBounds *old_bounds = ecs_get_mut(it->world, it->entities[i], LineBounds);
+    if (old_bounds && old_bounds->valid) {
+      damage_bounds(renderer, old_bounds);
+      line_index_remove(&renderer->line_index, it->entities[i], old_bounds);
+      old_bounds->valid = false;
+    }
+    if (it->event == EcsOnRemove)
+      continue;
+
+    LineBounds bounds;
+    line_world_bounds(&line[i], &position[i], &bounds);
+    damage_bounds(renderer, &bounds);
+    line_index_insert(&renderer->line_index, it->entities[i], &line[i], &position[i], &bounds);
+    // Always there through the With pair, written in place so bulk inserts don't queue a command per line
+    if (old_bounds) {
+      *old_bounds = bounds;
+    } else {
+      ecs_set_ptr(it->world, it->entities[i], LineBounds, &bounds);
+    }
 
-  // renderer->draw_context.surface = create_surface(new_width, new_height);
-  // glDeleteTextures(1, &renderer->texture);
-  // renderer->texture = create_texture_from_surface(&renderer->draw_context.surface);
-  // renderer->draw_context.canvas.height = new_height;
-  // renderer->draw_context.canvas.width = new_width;
+    // The cached screen geometry is rebuilt the next time the line is drawn
+    ScreenLine *screen = ecs_get_mut(it->world, it->entities[i], ScreenLine);
+    LineQuads *quads = ecs_get_mut(it->world, it->entities[i], LineQuads);
+    if (screen) {
+      screen->version = 0;
+    }
+    if (quads) {
+      quads->version = 0;
+    }
+  }
+  PROFILE_END();
 }
 
-void render_system(ecs_iter_t *it) {
-  SoftwareOpenGlRenderer *renderer = ecs_field(it, SoftwareOpenGlRenderer, 2); // Renderer($)
+// OnSet / OnRemove of Polyline and Position: damages where the path was and where it is now.
+// Polylines are few and long, they are culled by their bounds instead of going into the index.
+void polyline_bounds_observer(ecs_iter_t *it) {
+  SoftwareOpenGlRenderer *renderer = ecs_singleton_get_mut(it->world, SoftwareOpenGlRenderer);
+  if (!renderer)
+    return;
+
+  PROFILE_BEGIN("polyline_bounds_observer");
+  Polyline *polyline = ecs_field(it, Polyline, 0);
+  Position *position = ecs_field(it, Position, 1);
 
+  for (int i = 0; i < it->count; i++) {
+    LineBounds *old_bounds = ecs_get_mut(it->world, it->entities[i], LineBounds);
+    if (old_bounds && old_bounds->valid) {
+      damage_bounds(renderer, old_bounds);
+      old_bounds->valid = false;
+    }
+    if (it->event == EcsOnRemove)
+      continue;
+
+    LineBounds bounds;
+    polyline_world_bounds(&polyline[i], &position[i], &bounds);
+    damage_bounds(renderer, &bounds);
+    if (old_bounds) {
+      *old_bounds = bounds;
+    } else {
+      ecs_set_ptr(it->world, it->entities[i], LineBounds, &bounds);
+    }
+
+    PolylineStroke *stroke = ecs_get_mut(it->world, it->entities[i], PolylineStroke);
+    if (stroke) {
+      stroke->screen_version = stroke->prim_version = 0;
+    }
+  }
+  PROFILE_END();
+}
+
+typedef struct {
+  ecs_world_t *world;
+  uint32_t serial;
+} VisibleMarker;
+
+// Flags a line the index found in the redrawn area for line_transform_system
+static void mark_visible_line(void *ctx, const LineIndexEntry *entry) {
+  VisibleMarker *marker = ctx;
+  ScreenLine *screen = ecs_get_mut(marker->world, entry->entity, ScreenLine);
+  if (screen) {
+    screen->visible_serial = marker->serial;
+  }
+}
+
+// Works out what the incremental path redraws this frame: the damaged rects,
+// the world box lines are culled against and the lines the index finds in it.
+void render_prepare_system(ecs_iter_t *it) {
+  ecs_world_t *world = it->world;
+  SoftwareOpenGlRenderer *renderer = ecs_singleton_get_mut(world, SoftwareOpenGlRenderer); // Renderer($)
+  ecs_iter_fini(it);
+  if (!renderer)
+    return;
+
+  PROFILE_BEGIN("render_prepare");
+  RenderFrame *frame = &renderer->frame;
   Canvas *canvas = &renderer->draw_context.canvas;
   Surface *surface = &renderer->draw_context.surface;
+  frame->pending = false;
 
+  bool direct = !use_pipeline(renderer) && !use_tile_path(renderer);
+  apply_resolution(renderer, direct);
   canvas_update_transform(canvas);
-  rasterizer_clear_surface(surface);
+  // render_pipelined redraws on its own thread, render_tiles into the tile cache
+  if (!direct) {
+    PROFILE_END();
+    return;
+  }
 
-  float thickness = 10 * canvas->scale;
-  Line *line = ecs_field(it, Line, 0); // regular field
-  Position *transform = ecs_field(it, Position, 1);
+  if (canvas_changed(renderer)) {
+    damage_add_full(&renderer->damage);
+  }
+
+  float stroke = LINE_THICKNESS * canvas_pixel_scale(canvas);
+  frame->aggregate = wants_aggregate(renderer);
+  // The tone map scales by the densest pixel anywhere, so any change redraws everything
+  if (frame->aggregate != renderer->drawn_aggregate || (frame->aggregate && !damage_is_empty(&renderer->damage))) {
+    damage_add_full(&renderer->damage);
+  }
+
+  if (renderer->use_ring) {
+    upload_ring_poll(&renderer->ring);
+  }
+
+  frame->clip_count = damage_clip_rects(&renderer->damage, rasterizer_surface_rect(surface), frame->clips);
+  renderer->last_damage_rects = frame->clip_count;
+  if (frame->clip_count == 0) {
+    PROFILE_END();
+    return;
+  }
+
+  frame->full = renderer->damage.full;
+
+  Rect visible = rasterizer_surface_rect(surface);
+  if (!frame->full) {
+    visible = frame->clips[0];
+    for (int i = 1; i < frame->clip_count; i++) {
+      visible = rect_union(visible, frame->clips[i]);
+    }
+  }
+  // Same slack screen_rect_from_world adds around lines
+  visible = (Rect){visible.x0 - 2, visible.y0 - 2, visible.x1 + 2, visible.y1 + 2};
+  world_box_from_screen(canvas, visible, frame->world_min, frame->world_max);
+
+  // The line systems only compare serials, so their cost follows what is visible.
+  // Far out nearly every line is, they test bounds themselves to keep that in parallel.
+  frame->serial++;
+  if (!frame->aggregate) {
+    VisibleMarker marker = {.world = world, .serial = frame->serial};
+    line_index_query(&renderer->line_index, frame->world_min, frame->world_max, mark_visible_line, &marker);
+  }
+
+  frame->thickness = stroke;
+  draw_context_set_color(&renderer->draw_context, (ColorF){.r = 0.0f, .g = 0.0f, .b = 1.0f, .a = 1.0f});
+  if (frame->aggregate) {
+    density_resize(&renderer->density, surface->width, surface->height);
+    density_clear(&renderer->density);
+  }
+  frame->pending = true;
+  PROFILE_END();
+}
+
+// Line, Position, LineBounds, ScreenLine, Renderer($). Runs on the flecs workers, one table slice each.
+// Lines keep their screen endpoints until they or the canvas change, render_prepare_system marked the visible ones.
+// The affine is set up once per slice, the endpoints are scattered across components and
+// gathering them for canvas_transform_points_soa cost as much as the SIMD saved.
+void line_transform_system(ecs_iter_t *it) {
+  SoftwareOpenGlRenderer *renderer = ecs_field(it, SoftwareOpenGlRenderer, 4);
+  RenderFrame *frame = &renderer->frame;
+  if (!frame->pending)
+    return;
+
+  PROFILE_BEGIN("line_transform");
+  Line *line = ecs_field(it, Line, 0);
+  Position *position = ecs_field(it, Position, 1);
+  LineBounds *bounds = ecs_field(it, LineBounds, 2);
+  ScreenLine *screen = ecs_field(it, ScreenLine, 3);
+  Canvas *canvas = &renderer->draw_context.canvas;
+  CanvasAffine affine = canvas_affine(canvas);
+
+  for (int i = 0; i < it->count; i++) {
+    screen[i].visible = frame->aggregate ? bounds_overlap(&bounds[i], frame->world_min, frame->world_max) : screen[i].visible_serial == frame->serial;
+    if (!screen[i].visible || screen[i].version == canvas->version)
+      continue;
+
+    vec2 a, b;
+    glm_vec2_add(position[i].pos, line[i].a, a);
+    glm_vec2_add(position[i].pos, line[i].b, b);
+    canvas_affine_apply(&affine, a, screen[i].a);
+    canvas_affine_apply(&affine, b, screen[i].b);
+    screen[i].thickness = frame->thickness;
+    screen[i].version = canvas->version;
+  }
+  PROFILE_END();
+}
+
+// ScreenLine, LineQuads, Renderer($). Runs on the flecs workers after line_transform_system,
+// only lines whose endpoints moved on screen are set up again.
+void line_tessellate_system(ecs_iter_t *it) {
+  SoftwareOpenGlRenderer *renderer = ecs_field(it, SoftwareOpenGlRenderer, 2);
+  if (!renderer->frame.pending)
+    return;
+
+  PROFILE_BEGIN("line_tessellate");
+  ScreenLine *screen = ecs_field(it, ScreenLine, 0);
+  LineQuads *quads = ecs_field(it, LineQuads, 1);
+  const Surface *surface = &renderer->draw_context.surface;
+  uint32_t color = renderer->draw_context.color;
+
+  // Aggregated lines skip setup, each worker adds its hits straight into the shared counts
+  if (renderer->frame.aggregate) {
+    for (int i = 0; i < it->count; i++) {
+      if (screen[i].visible) {
+        density_add_line(&renderer->density, screen[i].a, screen[i].b);
+      }
+    }
+    PROFILE_END();
+    return;
+  }
+
+  // Prims only depend on the screen endpoints and the mode, their id is the entity for picking
+  RasterMode mode = rasterizer_get_mode(surface);
+  for (int i = 0; i < it->count; i++) {
+    if (!screen[i].visible || (quads[i].version == screen[i].version && quads[i].mode == mode))
+      continue;
+    quads[i].count = rasterizer_setup_line(surface, screen[i].a, screen[i].b, screen[i].thickness, color, quads[i].prims);
+    for (int k = 0; k < quads[i].count; k++) {
+      quads[i].prims[k].id = (uint32_t)it->entities[i];
+    }
+    quads[i].version = screen[i].version;
+    quads[i].mode = mode;
+  }
+  PROFILE_END();
+}
+
+// Polyline, Position, LineBounds, PolylineStroke, Renderer($). Runs on the flecs workers, each path
+// is transformed, tessellated into one strip and set up on the worker that owns it. Paths keep
+// their strip until they or the canvas change.
+void polyline_tessellate_system(ecs_iter_t *it) {
+  SoftwareOpenGlRenderer *renderer = ecs_field(it, SoftwareOpenGlRenderer, 4);
+  RenderFrame *frame = &renderer->frame;
+  if (!frame->pending)
+    return;
+
+  PROFILE_BEGIN("polyline_tessellate");
+  Polyline *polyline = ecs_field(it, Polyline, 0);
+  Position *position = ecs_field(it, Position, 1);
+  LineBounds *bounds = ecs_field(it, LineBounds, 2);
+  PolylineStroke *stroke = ecs_field(it, PolylineStroke, 3);
+  Canvas *canvas = &renderer->draw_context.canvas;
+  uint32_t color = renderer->draw_context.color;
 
   for (int i = 0; i < it->count; i++) {
-    ColorF color = {.r = 0.0f, .g = 0.0f, .b = 1.0f, .a = 1.0f};
+    PolylineStroke *out = &stroke[i];
+    uint32_t count = polyline[i].count;
+    out->visible = count > 0 && bounds_overlap(&bounds[i], frame->world_min, frame->world_max);
+    if (!out->visible)
+      continue;
+
+    if (out->screen_version != canvas->version) {
+      if (count > out->screen_capacity) {
+        out->screen_capacity = count;
+        out->screen = realloc(out->screen, count * sizeof(vec2));
+      }
+      for (uint32_t k = 0; k < count; k++) {
+        vec2 world;
+        glm_vec2_add(position[i].pos, polyline[i].points[k], world);
+        canvas_transform_point(canvas, world, out->screen[k]);
+      }
+      out->screen_version = canvas->version;
+    }
 
-    vec2 points[2];
-    glm_vec2_copy(line[i].a, points[0]);
-    glm_vec2_copy(line[i].b, points[1]);
+    // Same as lines, far out every segment is only counted
+    if (frame->aggregate) {
+      for (uint32_t k = count > 1 ? 1 : 0; k < count; k++) {
+        density_add_line(&renderer->density, out->screen[k ? k - 1 : 0], out->screen[k]);
+      }
+      continue;
+    }
 
-    transform_points(&transform[i], points, points, 2);
-    draw_context_draw_thick_line(&renderer->draw_context, points[0], points[1], thickness, color);
+    if (out->prim_version == canvas->version)
+      continue;
+    StrokeStyle style = polyline[i].style;
+    style.width *= canvas_pixel_scale(canvas);
+    stroke_tessellate(&out->strip, out->screen, (int)count, &style);
+    if (out->strip.count > out->prim_capacity) {
+      out->prim_capacity = out->strip.count;
+      out->prims = realloc(out->prims, out->prim_capacity * sizeof(RasterPrim));
+    }
+    out->prim_count = (uint32_t)stroke_setup_prims(&out->strip, color, renderer->draw_context.blend, out->prims);
+    for (uint32_t k = 0; k < out->prim_count; k++) {
+      out->prims[k].id = (uint32_t)it->entities[i];
+    }
+    out->prim_version = canvas->version;
   }
+  PROFILE_END();
+}
+
+static void reserve_prims(SoftwareOpenGlRenderer *renderer, uint32_t count) {
+  if (renderer->prim_count + count <= renderer->prim_capacity)
+    return;
+  uint32_t capacity = renderer->prim_capacity ? renderer->prim_capacity * 2 : 1024;
+  renderer->prim_capacity = capacity < renderer->prim_count + count ? renderer->prim_count + count : capacity;
+  renderer->prims = realloc(renderer->prims, renderer->prim_capacity * sizeof(RasterPrim));
+}
+
+// Polylines go first, lines are drawn over them like on the render thread
+static void gather_polyline_strokes(ecs_world_t *world, SoftwareOpenGlRenderer *renderer) {
+  if (!renderer->polyline_query)
+    return;
+
+  uint32_t version = renderer->draw_context.canvas.version;
+  ecs_iter_t it = ecs_query_iter(world, renderer->polyline_query);
+  while (ecs_query_next(&it)) {
+    const PolylineStroke *stroke = ecs_field(&it, PolylineStroke, 0);
+    for (int i = 0; i < it.count; i++) {
+      if (!stroke[i].visible || stroke[i].prim_version != version || stroke[i].prim_count == 0)
+        continue;
+      reserve_prims(renderer, stroke[i].prim_count);
+      memcpy(renderer->prims + renderer->prim_count, stroke[i].prims, stroke[i].prim_count * sizeof(RasterPrim));
+      renderer->prim_count += stroke[i].prim_count;
+      renderer->last_visible_lines++;
+    }
+  }
+}
+
+typedef struct {
+  ecs_world_t *world;
+  SoftwareOpenGlRenderer *renderer;
+  uint32_t version;
+  RasterMode mode;
+} GatherContext;
+
+// Highlights go last, blended over whatever the lines left
+static void gather_highlights(ecs_world_t *world, SoftwareOpenGlRenderer *renderer, const GatherContext *gather) {
+  if (!renderer->highlight_query)
+    return;
+
+  ecs_iter_t it = ecs_query_iter(world, renderer->highlight_query);
+  while (ecs_query_next(&it)) {
+    const LineQuads *quads = ecs_field(&it, LineQuads, 0);
+    for (int i = 0; i < it.count; i++) {
+      if (quads[i].count == 0 || quads[i].version != gather->version || quads[i].mode != gather->mode)
+        continue;
+      reserve_prims(renderer, (uint32_t)quads[i].count);
+      RasterPrim *prims = renderer->prims + renderer->prim_count;
+      memcpy(prims, quads[i].prims, quads[i].count * sizeof(RasterPrim));
+      rasterizer_blend_prims(prims, quads[i].count, BLEND_MODE_SOURCE_OVER, renderer->highlight_color);
+      renderer->prim_count += quads[i].count;
+    }
+  }
+}
+
+static void gather_line_quads(void *ctx, const LineIndexEntry *entry) {
+  GatherContext *gather = ctx;
+  SoftwareOpenGlRenderer *renderer = gather->renderer;
+  const LineQuads *quads = ecs_get(gather->world, entry->entity, LineQuads);
+  // Set up for another view, or the line changed and was culled since
+  if (!quads || quads->count == 0 || quads->version != gather->version || quads->mode != gather->mode)
+    return;
+
+  reserve_prims(renderer, (uint32_t)quads->count);
+  for (int i = 0; i < quads->count; i++) {
+    renderer->prims[renderer->prim_count++] = quads->prims[i];
+  }
+  renderer->last_visible_lines++;
+}
+
+// Rasterizes the prims the line systems set up for this frame into the damaged
+// rects, or does nothing at all. Only lines the index finds in the damage are visited.
+static void render_damaged(ecs_iter_t *it) {
+  SoftwareOpenGlRenderer *renderer = ecs_singleton_get_mut(it->world, SoftwareOpenGlRenderer); // Renderer($)
+  if (!renderer || !renderer->frame.pending) {
+    ecs_iter_fini(it);
+    return;
+  }
+
+  RenderFrame *frame = &renderer->frame;
+  Canvas *canvas = &renderer->draw_context.canvas;
+  Surface *surface = &renderer->draw_context.surface;
+
+  PROFILE_BEGIN("clear");
+  if (frame->full) {
+    rasterizer_clear_surface(surface);
+    draw_context_set_clips(&renderer->draw_context, NULL, 0);
+  } else {
+    for (int i = 0; i < frame->clip_count; i++) {
+      rasterizer_clear_rect(surface, frame->clips[i]);
+    }
+    draw_context_set_clips(&renderer->draw_context, frame->clips, frame->clip_count);
+  }
+  PROFILE_END();
+
+  if (frame->aggregate) {
+    ecs_iter_fini(it);
+    PROFILE_BEGIN("tone_map");
+    density_tone_map(&renderer->density, surface, rasterizer_surface_rect(surface));
+    PROFILE_END();
+  } else {
+    PROFILE_BEGIN("cull");
+    renderer->prim_count = 0;
+    renderer->last_visible_lines = 0;
+    gather_polyline_strokes(it->world, renderer);
+    GatherContext gather = {.world = it->world, .renderer = renderer, .version = canvas->version, .mode = rasterizer_get_mode(surface)};
+    line_index_query(&renderer->line_index, frame->world_min, frame->world_max, gather_line_quads, &gather);
+    gather_highlights(it->world, renderer, &gather);
+    ecs_iter_fini(it);
+    PROFILE_END();
+
+    PROFILE_BEGIN("rasterize");
+    draw_context_begin(&renderer->draw_context);
+    draw_context_draw_prims(&renderer->draw_context, renderer->prims, (int)renderer->prim_count);
+    draw_context_flush(&renderer->draw_context);
+    draw_context_set_clips(&renderer->draw_context, NULL, 0);
+    PROFILE_END();
+  }
+
+  PROFILE_BEGIN("update_texture");
+  // Uploads synchronously when the ring has no buffer free
+  bool uploaded = renderer->use_ring && upload_ring_submit(&renderer->ring, renderer->texture, surface->buffer, frame->clips, frame->clip_count);
+  if (!uploaded && renderer->damage.full) {
+    update_texture(renderer->texture, surface);
+  } else if (!uploaded) {
+    update_texture_rects(renderer->texture, surface, frame->clips, frame->clip_count);
+  }
+  PROFILE_END();
+
+  damage_reset(&renderer->damage);
+  renderer->drawn_version = canvas->version;
+  renderer->drawn_mode = rasterizer_get_mode(surface);
+  renderer->drawn_aggregate = frame->aggregate;
+}
+
+// Copies the visible polylines into the job in world space, the render thread tessellates them
+static void snapshot_polylines(ecs_world_t *world, SoftwareOpenGlRenderer *renderer, RenderJob *job, vec2 world_min, vec2 world_max) {
+  job->point_count = job->polyline_count = 0;
+  if (!renderer->polyline_query)
+    return;
+
+  float scale = canvas_pixel_scale(&renderer->draw_context.canvas);
+  ecs_iter_t it = ecs_query_iter(world, renderer->polyline_query);
+  while (ecs_query_next(&it)) {
+    const Polyline *polyline = ecs_field(&it, Polyline, 1);
+    const Position *position = ecs_field(&it, Position, 2);
+    const LineBounds *bounds = ecs_field(&it, LineBounds, 3);
+    for (int i = 0; i < it.count; i++) {
+      if (polyline[i].count == 0 || !bounds_overlap(&bounds[i], world_min, world_max))
+        continue;
+      StrokeStyle style = polyline[i].style;
+      style.width *= scale;
+      render_job_add_polyline(job, (const vec2 *)polyline[i].points, polyline[i].count, position[i].pos, &style);
+    }
+  }
+}
+
+// Presents the frame the render thread finished since last time and hands it
+// the next one. Frames are redrawn in full from a snapshot of the canvas and
+// the visible lines, damage only decides whether a new frame is needed.
+static void render_pipelined(ecs_iter_t *it) {
+  SoftwareOpenGlRenderer *renderer = ecs_singleton_get_mut(it->world, SoftwareOpenGlRenderer); // Renderer($)
+  if (!renderer) {
+    ecs_iter_fini(it);
+    return;
+  }
+
+  Canvas *canvas = &renderer->draw_context.canvas;
+  Surface *surface = &renderer->draw_context.surface;
+
+  canvas_update_transform(canvas);
+  if (canvas_changed(renderer)) {
+    damage_add_full(&renderer->damage);
+  }
+
+  RenderJob *finished = render_thread_poll(renderer->pipeline);
+  if (finished) {
+    PROFILE_BEGIN("update_texture");
+    // Dropped when the window was resized after it was submitted, the resize damaged everything
+    if (finished->surface.width == surface->width && finished->surface.height == surface->height) {
+      update_texture(renderer->texture, &finished->surface);
+    }
+    render_thread_release(renderer->pipeline, finished);
+    PROFILE_END();
+  }
+
+  renderer->last_damage_rects = damage_is_empty(&renderer->damage) ? 0 : 1;
+  // Still rendering, the damage waits for the next frame
+  RenderJob *job = damage_is_empty(&renderer->damage) ? NULL : render_thread_acquire(renderer->pipeline);
+  if (!job) {
+    ecs_iter_fini(it);
+    return;
+  }
+
+  PROFILE_BEGIN("cull");
+  Rect visible = rasterizer_surface_rect(surface);
+  visible = (Rect){visible.x0 - 2, visible.y0 - 2, visible.x1 + 2, visible.y1 + 2};
+  vec2 world_min, world_max;
+  world_box_from_screen(canvas, visible, world_min, world_max);
+  job->lines.count = 0;
+  line_index_query(&renderer->line_index, world_min, world_max, batch_indexed_line, &job->lines);
+  snapshot_polylines(it->world, renderer, job, world_min, world_max);
+  renderer->last_visible_lines = job->lines.count + job->polyline_count;
+  ecs_iter_fini(it);
+  PROFILE_END();
+
+  job->canvas = *canvas;
+  job->thickness = LINE_THICKNESS * canvas_pixel_scale(canvas);
+  job->color = (ColorF){.r = 0.0f, .g = 0.0f, .b = 1.0f, .a = 1.0f};
+  job->tiled = renderer->draw_context.tiler != NULL;
+  // Mode and clear color go with the job, the render thread never reads the renderer's surface
+  job->surface.state = surface->state;
+  render_thread_submit(renderer->pipeline, job);
+
+  damage_reset(&renderer->damage);
+  renderer->drawn_version = canvas->version;
+  renderer->drawn_mode = rasterizer_get_mode(surface);
+  renderer->drawn_aggregate = false;
+}
+
+typedef struct {
+  int32_t x;
+  int32_t y;
+  float distance; // From the screen center, squared
+} MissingTile;
+
+static int compare_missing(const void *a, const void *b) {
+  float da = ((const MissingTile *)a)->distance, db = ((const MissingTile *)b)->distance;
+  return (da > db) - (da < db);
+}
+
+static void draw_tile_task(void *ctx, uint32_t index) {
+  SoftwareOpenGlRenderer *renderer = ctx;
+  render_job_draw(&renderer->tile_jobs[index], &renderer->tile_scratch[index], NULL);
+}
+
+// Sets up the job drawing one tile of the current zoom into its cache slot
+static void setup_tile_job(ecs_world_t *world, SoftwareOpenGlRenderer *renderer, RenderJob *job, CachedTile *tile) {
+  // Every tile of a zoom is set up in level pixels with the same transform, the tile's
+  // surface sits at its corner. Its prims are then the ones a draw of the whole level
+  // would make, only clipped, so neighbouring tiles meet without seams.
+  canvas_init(&job->canvas, 0.0f, 0.0f);
+  job->canvas.scale = tile->scale;
+  canvas_update_transform(&job->canvas);
+  Point corner = {tile->x * TILE_CACHE_SIZE, tile->y * TILE_CACHE_SIZE};
+
+  vec2 world_min, world_max;
+  Rect area = {corner.x - 2, corner.y - 2, corner.x + TILE_CACHE_SIZE + 2, corner.y + TILE_CACHE_SIZE + 2};
+  world_box_from_screen(&job->canvas, area, world_min, world_max);
+  job->lines.count = 0;
+  line_index_query(&renderer->line_index, world_min, world_max, batch_indexed_line, &job->lines);
+  snapshot_polylines(world, renderer, job, world_min, world_max);
+  renderer->last_visible_lines += job->lines.count + job->polyline_count;
+
+  job->thickness = LINE_THICKNESS * tile->scale;
+  job->color = (ColorF){.r = 0.0f, .g = 0.0f, .b = 1.0f, .a = 1.0f};
+  job->surface = (Surface){
+      .width = TILE_CACHE_SIZE,
+      .height = TILE_CACHE_SIZE,
+      .buffer = tile->pixels,
+      .origin = corner,
+      .state = renderer->draw_context.surface.state,
+  };
+}
+
+// Composes the surface from cached tiles of the current zoom. Missing tiles are drawn
+// on the pool nearest the center first, a few per frame while zooming. Until they
+// are there the closest cached zoom is shown scaled and the frame is composed again.
+static void render_tiles(ecs_iter_t *it) {
+  SoftwareOpenGlRenderer *renderer = ecs_singleton_get_mut(it->world, SoftwareOpenGlRenderer); // Renderer($)
+  if (!renderer) {
+    ecs_iter_fini(it);
+    return;
+  }
+
+  Canvas *canvas = &renderer->draw_context.canvas;
+  Surface *surface = &renderer->draw_context.surface;
+  TileCache *cache = &renderer->tile_cache;
+  tile_cache_set_state(cache, surface->state);
+  if (!canvas_changed(renderer) && damage_is_empty(&renderer->damage) && !renderer->drawn_aggregate) {
+    renderer->last_damage_rects = 0;
+    ecs_iter_fini(it);
+    return;
+  }
+
+  PROFILE_BEGIN("tiles_draw");
+  tile_cache_begin(cache);
+  renderer->last_visible_lines = 0;
+  float scale = canvas->scale;
+  // Level pixel at the surface's top left, whole pixels so cached tiles line up when panning
+  vec2 origin = {
+      floorf(canvas->position[0] - canvas->width * 0.5f + 0.5f),
+      floorf(canvas->position[1] - canvas->height * 0.5f + 0.5f),
+  };
+  int32_t x0 = (int32_t)floorf(origin[0] / TILE_CACHE_SIZE);
+  int32_t y0 = (int32_t)floorf(origin[1] / TILE_CACHE_SIZE);
+  int32_t x1 = (int32_t)floorf((origin[0] + surface->width - 1) / TILE_CACHE_SIZE);
+  int32_t y1 = (int32_t)floorf((origin[1] + surface->height - 1) / TILE_CACHE_SIZE);
+
+  MissingTile *missing = malloc((size_t)(x1 - x0 + 1) * (y1 - y0 + 1) * sizeof(MissingTile));
+  uint32_t missing_count = 0;
+  for (int32_t y = y0; y <= y1; y++) {
+    for (int32_t x = x0; x <= x1; x++) {
+      if (tile_cache_find(cache, scale, x, y)) {
+        cache->reused++;
+        continue;
+      }
+      float dx = (x + 0.5f) * TILE_CACHE_SIZE - (origin[0] + surface->width * 0.5f);
+      float dy = (y + 0.5f) * TILE_CACHE_SIZE - (origin[1] + surface->height * 0.5f);
+      missing[missing_count++] = (MissingTile){x, y, dx * dx + dy * dy};
+    }
+  }
+  qsort(missing, missing_count, sizeof(MissingTile), compare_missing);
+
+  uint32_t budget = scale != renderer->tiles_scale ? TILE_ZOOM_JOBS : RENDERER_TILE_JOBS;
+  CachedTile *drawn[RENDERER_TILE_JOBS];
+  uint32_t job_count = 0;
+  for (uint32_t i = 0; i < missing_count && job_count < budget; i++) {
+    CachedTile *tile = tile_cache_insert(cache, scale, missing[i].x, missing[i].y);
+    if (!tile)
+      break;
+    setup_tile_job(it->world, renderer, &renderer->tile_jobs[job_count], tile);
+    drawn[job_count++] = tile;
+  }
+  ecs_iter_fini(it);
+  free(missing);
+
+  thread_pool_parallel_for(renderer->pool, job_count, draw_tile_task, renderer);
+  for (uint32_t i = 0; i < job_count; i++) {
+    tile_cache_set_valid(cache, drawn[i]);
+  }
+  cache->drawn = job_count;
+  PROFILE_END();
+
+  PROFILE_BEGIN("tiles_compose");
+  bool complete = true;
+  for (int32_t y = y0; y <= y1; y++) {
+    for (int32_t x = x0; x <= x1; x++) {
+      int sx = x * TILE_CACHE_SIZE - (int)origin[0];
+      int sy = y * TILE_CACHE_SIZE - (int)origin[1];
+      const CachedTile *tile = tile_cache_find(cache, scale, x, y);
+      if (tile) {
+        tile_cache_blit(tile, surface, sx, sy);
+        continue;
+      }
+      Rect dest = {sx, sy, sx + TILE_CACHE_SIZE, sy + TILE_CACHE_SIZE};
+      rasterizer_clear_rect(surface, rect_intersect(dest, rasterizer_surface_rect(surface)));
+      cache->scaled += tile_cache_draw_scaled(cache, surface, dest, scale, origin);
+      complete = false;
+    }
+  }
+  PROFILE_END();
+
+  PROFILE_BEGIN("update_texture");
+  update_texture(renderer->texture, surface);
+  PROFILE_END();
+
+  damage_reset(&renderer->damage);
+  // Comes back next frame for the tiles still missing
+  if (!complete) {
+    damage_add_full(&renderer->damage);
+  }
+  renderer->last_damage_rects = 1;
+  renderer->drawn_version = canvas->version;
+  renderer->drawn_mode = rasterizer_get_mode(surface);
+  renderer->drawn_aggregate = false;
+  renderer->tiles_scale = scale;
+}
+
+// Run callback
+void render_system(ecs_iter_t *it) {
+  PROFILE_BEGIN("render_system");
+  SoftwareOpenGlRenderer *renderer = ecs_singleton_get_mut(it->world, SoftwareOpenGlRenderer);
+  uint64_t start = clock_now_ns();
+  if (renderer && use_tile_path(renderer)) {
+    render_tiles(it);
+  } else if (renderer && use_pipeline(renderer)) {
+    render_pipelined(it);
+  } else {
+    // The overview is drawn here with the render thread on too, a frame it still finishes is stale
+    RenderJob *stale = renderer && renderer->pipeline ? render_thread_poll(renderer->pipeline) : NULL;
+    if (stale) {
+      render_thread_release(renderer->pipeline, stale);
+    }
+    render_damaged(it);
+    if (renderer) {
+      float ms = (float)(clock_now_ns() - start) / 1e6f;
+      resolution_update(&renderer->resolution, ms, renderer->frame.pending, renderer->frame.full);
+    }
+  }
+  PROFILE_END();
 }
 
 void renderer_render(SoftwareOpenGlRenderer *renderer, ecs_world_t *world, ecs_query_t *query) {
@@ -89,69 +866,158 @@ void renderer_render(SoftwareOpenGlRenderer *renderer, ecs_world_t *world, ecs_q
 
   canvas_update_transform(canvas);
   rasterizer_clear_surface(surface);
+  draw_context_begin(&renderer->draw_context);
 
   // TODO: Hard coded draw system for lines
-  float thickness = 10 * canvas->scale;
+  float thickness = LINE_THICKNESS * canvas_pixel_scale(canvas);
+  renderer->lines.count = 0;
   ecs_iter_t it = ecs_query_iter(world, query);
   while (ecs_query_next(&it)) {
     Line *line = ecs_field(&it, Line, 0);
     Position *transform = ecs_field(&it, Position, 1);
-
-    for (int i = 0; i < it.count; i++) {
-      ColorF color = {.r = 0.0f, .g = 0.0f, .b = 1.0f, .a = 1.0f};
-
-      // Move to world
-      vec2 points[2];
-      points[0][0] = line[i].a[0];
-      points[0][1] = line[i].a[1];
-      points[1][0] = line[i].b[0];
-      points[1][1] = line[i].b[1];
-
-      transform_points(&transform[i], points, points, 2);
-      draw_context_draw_thick_line(&renderer->draw_context, points[0], points[1], thickness, color);
-    }
+    line_batch_append_world(&renderer->lines, line, transform, it.count);
   }
+  draw_context_set_color(&renderer->draw_context, (ColorF){.r = 0.0f, .g = 0.0f, .b = 1.0f, .a = 1.0f});
+  draw_context_lines(&renderer->draw_context, &renderer->lines, thickness);
 
   // Draw line
   ColorF color = {.r = 0.2f, .g = 0.4f, .b = 1.0f, .a = 1.0f};
   vec2 p0 = {0, 50};
   vec2 p1 = {200, 50};
   draw_context_draw_thick_line(&renderer->draw_context, p0, p1, thickness, color);
+  draw_context_flush(&renderer->draw_context);
 
   update_texture(renderer->texture, surface);
 }
 
-SoftwareOpenGlRenderer renderer_create(uint32_t width, uint32_t height) {
-  Surface surface;
-  resize_surface(&surface, width, height);
-  GLuint texture = create_texture_from_surface(&surface);
+SoftwareOpenGlRenderer renderer_create(uint32_t width, uint32_t height, uint32_t threads) {
+  Surface surface = {0};
+  rasterizer_surface_resize(&surface, width, height);
+  GLuint texture = create_texture(width, height);
   Canvas canvas;
   canvas_init(&canvas, width, height);
 
+  ThreadPool *pool = thread_pool_create(threads);
+  TileRasterizer *tiler = tile_rasterizer_create(pool);
+
   DrawContext draw_context = {
       .surface = surface,
       .canvas = canvas,
+      .tiler = tiler,
   };
-  return (SoftwareOpenGlRenderer){
+  SoftwareOpenGlRenderer renderer = {
       .draw_context = draw_context,
       .texture = texture,
+      .pool = pool,
+      .tiler = tiler,
+      .highlight_color = pack_color_premultiplied((ColorF){.r = 1.0f, .g = 0.6f, .b = 0.0f, .a = 0.5f}),
   };
+  damage_add_full(&renderer.damage);
+  line_index_init(&renderer.line_index);
+  density_set_ramp(&renderer.density, (ColorF){.r = 0.68f, .g = 0.85f, .b = 1.0f, .a = 1.0f}, (ColorF){.r = 0.0f, .g = 0.0f, .b = 0.55f, .a = 1.0f});
+
+  tile_cache_init(&renderer.tile_cache, TILE_CACHE_DEFAULT_BUDGET);
+  resolution_init(&renderer.resolution, RESOLUTION_DEFAULT_BUDGET_MS);
+
+  renderer.ring_available = upload_ring_init(&renderer.ring, width, height);
+  renderer.use_ring = renderer.ring_available;
+  // The render thread is opt-in, only the direct path does damage, density, picking, highlights and dynamic resolution
+  renderer.pipeline = NULL;
+  return renderer;
 }
 
 void renderer_free(SoftwareOpenGlRenderer *renderer) {
   Surface *surface = &renderer->draw_context.surface;
+  render_thread_destroy(renderer->pipeline);
   glDeleteTextures(1, &renderer->texture);
-  free(surface->buffer);
+  rasterizer_surface_free(surface);
+  draw_context_free(&renderer->draw_context);
+  line_batch_free(&renderer->lines);
+  free(renderer->prims);
+  density_free(&renderer->density);
+  upload_ring_free(&renderer->ring);
+  tile_cache_free(&renderer->tile_cache);
+  // Tile job surfaces point into the cache
+  for (int i = 0; i < RENDERER_TILE_JOBS; i++) {
+    line_batch_free(&renderer->tile_jobs[i].lines);
+    free(renderer->tile_jobs[i].points);
+    free(renderer->tile_jobs[i].polylines);
+    render_scratch_free(&renderer->tile_scratch[i]);
+  }
+  line_index_free(&renderer->line_index);
+  tile_rasterizer_free(renderer->tiler);
+  thread_pool_destroy(renderer->pool);
 }
 
 void renderer_handle_resize(SoftwareOpenGlRenderer *renderer, uint32_t new_width, uint32_t new_height) {
-  Surface *surface = &renderer->draw_context.surface;
-  free(surface->buffer);
   glDeleteTextures(1, &renderer->texture);
-  // renderer->draw_context.surface = create_surface(new_width, new_height);
-  renderer->texture = create_texture_from_surface(&renderer->draw_context.surface);
+  renderer->texture = create_texture(new_width, new_height);
   renderer->draw_context.canvas.height = new_height;
   renderer->draw_context.canvas.width = new_width;
+  resize_surface(renderer);
+}
+
+void renderer_set_clear_color(SoftwareOpenGlRenderer *renderer, ColorF color) {
+  rasterizer_set_clear_color(&renderer->draw_context.surface, color);
+  damage_add_full(&renderer->damage);
+}
+
+void renderer_set_tiled(SoftwareOpenGlRenderer *renderer, bool enabled) { renderer->draw_context.tiler = enabled ? renderer->tiler : NULL; }
+
+void renderer_set_upload_ring(SoftwareOpenGlRenderer *renderer, bool enabled) {
+  enabled = enabled && renderer->ring_available;
+  if (enabled == renderer->use_ring)
+    return;
+
+  renderer->use_ring = enabled;
+}
+
+void renderer_set_pipelined(SoftwareOpenGlRenderer *renderer, bool enabled) {
+  if (enabled == (renderer->pipeline != NULL))
+    return;
+
+  if (enabled) {
+    // Both draw on the pool, and only the direct path writes ids
+    renderer_set_tile_cache(renderer, false);
+    renderer_set_picking(renderer, false);
+    renderer->pipeline = render_thread_create(renderer->pool);
+  } else {
+    render_thread_destroy(renderer->pipeline);
+    renderer->pipeline = NULL;
+  }
+
+  // The surface missed everything the render thread drew
+  damage_add_full(&renderer->damage);
+}
+
+void renderer_set_tile_cache(SoftwareOpenGlRenderer *renderer, bool enabled) {
+  if (enabled == renderer->use_tile_cache)
+    return;
+
+  // The render thread's tiler and the tile jobs both run on the pool
+  if (enabled) {
+    renderer_set_pipelined(renderer, false);
+    renderer_set_picking(renderer, false);
+  } else {
+    // Edits stop invalidating once nothing is valid, tiles kept now would be stale when turned back on
+    tile_cache_clear(&renderer->tile_cache);
+  }
+  renderer->use_tile_cache = enabled;
+  damage_add_full(&renderer->damage);
+}
+
+void renderer_set_picking(SoftwareOpenGlRenderer *renderer, bool enabled) {
+  Surface *surface = &renderer->draw_context.surface;
+  if (enabled == (surface->ids != NULL))
+    return;
+
+  // Tiles and the render thread's frames carry no ids
+  if (enabled) {
+    renderer_set_pipelined(renderer, false);
+    renderer_set_tile_cache(renderer, false);
+  }
+  rasterizer_surface_set_ids(surface, enabled);
+  damage_add_full(&renderer->damage);
 }
 
-void renderer_set_clear_color(SoftwareOpenGlRenderer *renderer, ColorF color) { rasterizer_set_clear_color(&renderer->draw_context.surface, color); }
+void renderer_set_mode(SoftwareOpenGlRenderer *renderer, RasterMode mode) { rasterizer_set_mode(&renderer->draw_context.surface, mode); }
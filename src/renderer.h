@@ -2,22 +2,108 @@
 #define RENDERER_H
 
 #include "SDL3/SDL_opengl.h"
+#include "damage.h"
 #include "drawer.h"
 #include "flecs.h"
+#include "graphics/density.h"
+#include "line_index.h"
+#include "render_thread.h"
+#include "resolution.h"
+#include "thread_pool.h"
+#include "tile_cache.h"
+#include "upload_ring.h"
+#include <stdbool.h>
 #include <stdint.h>
 
+// Tiles drawn into the tile cache per frame at most, one job each
+#define RENDERER_TILE_JOBS 16
+
+// The redraw of the current frame, set up by render_prepare_system for the later phases
+typedef struct {
+  bool pending; // Nothing is drawn when false
+  bool full;
+  uint32_t serial; // Bumped for every frame that is drawn
+  Rect clips[DAMAGE_MAX_RECTS];
+  int clip_count;
+  vec2 world_min; // Lines outside this box are culled
+  vec2 world_max;
+  float thickness;
+  bool aggregate; // Lines go into the density buffer instead of being set up
+} RenderFrame;
+
 typedef struct {
   GLuint texture;
   DrawContext draw_context;
+  ThreadPool *pool;
+  TileRasterizer *tiler;
+
+  // Incremental redraw
+  Damage damage;
+  uint32_t drawn_version; // Canvas version of the surface contents
+  RasterMode drawn_mode;
+  bool drawn_aggregate;
+  int last_damage_rects; // 0 when the last frame was skipped
+  int last_visible_lines;
+  // Surface resolution for the direct path, fed with how long render_system took
+  ResolutionController resolution;
+
+  // World-space lines, kept in sync by line_bounds_observer
+  LineIndex line_index;
+  // Endpoints of the lines drawn this frame
+  LineBatch lines;
+  RenderFrame frame;
+  DensityBuffer density;
+  // PolylineStroke, set up by main once the component is registered
+  ecs_query_t *polyline_query;
+  // LineQuads of the selected lines, set up by main like polyline_query. Their
+  // prims are drawn a second time, blending highlight_color over the line.
+  ecs_query_t *highlight_query;
+  uint32_t highlight_color; // Premultiplied
+  // Prims of the visible polylines and lines, gathered before rasterizing
+  RasterPrim *prims;
+  uint32_t prim_count;
+  uint32_t prim_capacity;
+
+  // Uploads the damaged rects through a ring of pixel buffers when enabled
+  UploadRing ring;
+  bool ring_available;
+  bool use_ring;
+
+  // Rasterizes frame N+1 on its own thread while frame N is uploaded, NULL when off (the default).
+  // Density overview frames still take the direct path.
+  RenderThread *pipeline;
+
+  // Composes frames from tiles cached per zoom when enabled, never together with the pipeline
+  TileCache tile_cache;
+  bool use_tile_cache;
+  float tiles_scale; // Zoom of the last composed frame
+  RenderJob tile_jobs[RENDERER_TILE_JOBS];
+  RenderScratch tile_scratch[RENDERER_TILE_JOBS];
 } SoftwareOpenGlRenderer;
 
+extern ECS_COMPONENT_DECLARE(SoftwareOpenGlRenderer);
 
-SoftwareOpenGlRenderer renderer_create(uint32_t width, uint32_t height);
+// threads sizes the rasterizer pool, counting the calling thread
+SoftwareOpenGlRenderer renderer_create(uint32_t width, uint32_t height, uint32_t threads);
 void renderer_free(SoftwareOpenGlRenderer *renderer);
 void renderer_set_clear_color(SoftwareOpenGlRenderer *renderer, ColorF color);
+void renderer_set_tiled(SoftwareOpenGlRenderer *renderer, bool enabled);
+void renderer_set_upload_ring(SoftwareOpenGlRenderer *renderer, bool enabled);
+void renderer_set_pipelined(SoftwareOpenGlRenderer *renderer, bool enabled);
+void renderer_set_tile_cache(SoftwareOpenGlRenderer *renderer, bool enabled);
+// Keeps the surface ids for picking.h up to date, turns the tile cache and the render thread off
+void renderer_set_picking(SoftwareOpenGlRenderer *renderer, bool enabled);
+void renderer_set_mode(SoftwareOpenGlRenderer *renderer, RasterMode mode);
+void renderer_handle_resize(SoftwareOpenGlRenderer *renderer, uint32_t new_width, uint32_t new_height);
 
-// ECS
+// ECS, in pipeline order. The line systems are multi-threaded and only touch their own entities.
+void render_prepare_system(ecs_iter_t *it);
+void line_transform_system(ecs_iter_t *it);
+void line_tessellate_system(ecs_iter_t *it);
+void polyline_tessellate_system(ecs_iter_t *it);
 void render_system(ecs_iter_t *it);
 void surface_resize_system(ecs_iter_t *it);
+void line_bounds_observer(ecs_iter_t *it);
+void polyline_bounds_observer(ecs_iter_t *it);
 
 #endif
@@ -0,0 +1,44 @@
+#include "resolution.h"
+#include <math.h>
+
+// Largest step at or below scale, the slack keeps exact multiples where they are
+static float quantize(float scale) {
+  scale = floorf(scale / RESOLUTION_STEP + 1e-3f) * RESOLUTION_STEP;
+  return scale < RESOLUTION_MIN_SCALE ? RESOLUTION_MIN_SCALE : (scale > 1.0f ? 1.0f : scale);
+}
+
+void resolution_init(ResolutionController *controller, float budget_ms) {
+  *controller = (ResolutionController){.budget_ms = budget_ms, .scale = 1.0f};
+}
+
+float resolution_update(ResolutionController *controller, float render_ms, bool drew, bool full) {
+  if (!controller->enabled) {
+    controller->scale = 1.0f;
+    controller->restored = false;
+    return controller->scale;
+  }
+
+  if (!drew) {
+    controller->restored = controller->scale < 1.0f;
+    controller->scale = 1.0f;
+    return controller->scale;
+  }
+
+  controller->last_ms = render_ms;
+  if (controller->restored) {
+    controller->restored = false;
+    return controller->scale;
+  }
+
+  // Scale this frame would have needed to land at the headroom
+  float fit = controller->scale * sqrtf(controller->budget_ms * RESOLUTION_HEADROOM / fmaxf(render_ms, 1e-3f));
+  if (render_ms > controller->budget_ms) {
+    // At least a step down, the cost may not follow the pixel count exactly
+    float lower = quantize(fit);
+    controller->scale = lower < controller->scale ? lower : quantize(controller->scale - RESOLUTION_STEP);
+  } else if (full) {
+    float higher = quantize(fit);
+    controller->scale = higher > controller->scale ? higher : controller->scale;
+  }
+  return controller->scale;
+}
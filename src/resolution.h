@@ -0,0 +1,31 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include <stdbool.h>
+
+// Resolution scales are multiples of the step, never below the minimum
+#define RESOLUTION_STEP 0.125f
+#define RESOLUTION_MIN_SCALE 0.25f
+// A scale is picked when its predicted cost is at most this share of the budget
+#define RESOLUTION_HEADROOM 0.85f
+#define RESOLUTION_DEFAULT_BUDGET_MS 8.0f
+
+// Picks the surface resolution from the measured cost of drawing it, assumed
+// to grow with the pixel count, the square of the scale. Scales only go up on
+// full redraws, which are the only ones that tell the cost of the whole
+// surface, and straight back to 1 on the first idle frame.
+typedef struct {
+  bool enabled;
+  float budget_ms;
+  float scale;   // For the next frame, 1 at full resolution
+  float last_ms; // Cost of the last frame that drew anything
+  // The scale just went back to 1 while idle, the full redraw that follows is no reason to drop it
+  bool restored;
+} ResolutionController;
+
+void resolution_init(ResolutionController *controller, float budget_ms);
+// Feeds the cost of a frame, drew is false when nothing was redrawn and full when
+// everything was. Returns the scale for the next frame.
+float resolution_update(ResolutionController *controller, float render_ms, bool drew, bool full);
+
+#endif // RESOLUTION_H
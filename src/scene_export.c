@@ -0,0 +1,314 @@
+// Headless scene export for thumbnails and previews, no SDL or OpenGL:
+//   scene_export [--size <w>x<h>] [--grid <n>] [--format qoi|ppm] [--out <dir>] scene.bin...
+// Every scene is rendered fitted to its bounds, plus n x n zoomed views tiling the
+// bounds with --grid. A batch of images is encoded and written on the pool while
+// the next one is rasterized. Prints one JSON object with the throughput.
+
+#include "canvas.h"
+#include "clock.h"
+#include "components.h"
+#include "drawer.h"
+#include "flecs.h"
+#include "image_file.h"
+#include "scene_file.h"
+#include "thread_pool.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+// Images per hand-off to the encoder, enough to keep every pool thread busy
+#define EXPORT_BATCH 32
+#define EXPORT_PATH_MAX 512
+// n x n zoomed views per scene at most, keeps the image count sane
+#define EXPORT_MAX_GRID 64
+// Fraction of the image the fitted view leaves around the scene
+#define EXPORT_MARGIN 0.05f
+
+// Defined per executable, like in main.c. Only lines are exported.
+ECS_COMPONENT_DECLARE(Position);
+ECS_COMPONENT_DECLARE(Line);
+ECS_COMPONENT_DECLARE(Polyline);
+ECS_COMPONENT_DECLARE(PolylineStroke);
+
+typedef struct {
+  Surface surfaces[EXPORT_BATCH];
+  char paths[EXPORT_BATCH][EXPORT_PATH_MAX];
+  bool written[EXPORT_BATCH];
+  uint32_t count;
+  ImageFormat format;
+} ExportBatch;
+
+// Encodes one batch at a time on the pool, so the main thread can rasterize the next
+typedef struct {
+  thrd_t thread;
+  ThreadPool *pool;
+  mtx_t lock;
+  cnd_t wake;
+  cnd_t idle;
+  ExportBatch *pending; // Set by the main thread, cleared once encoded
+  bool quit;
+  uint32_t failed;
+} Encoder;
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  int grid;
+  ImageFormat format;
+  const char *out_dir;
+} ExportConfig;
+
+static void encode_task(void *ctx, uint32_t index) {
+  ExportBatch *batch = ctx;
+  batch->written[index] = image_file_write(batch->paths[index], &batch->surfaces[index], batch->format);
+}
+
+static int encoder_main(void *arg) {
+  Encoder *encoder = arg;
+  mtx_lock(&encoder->lock);
+  for (;;) {
+    while (!encoder->quit && !encoder->pending) {
+      cnd_wait(&encoder->wake, &encoder->lock);
+    }
+    if (!encoder->pending)
+      break;
+    ExportBatch *batch = encoder->pending;
+    mtx_unlock(&encoder->lock);
+
+    thread_pool_parallel_for(encoder->pool, batch->count, encode_task, batch);
+
+    mtx_lock(&encoder->lock);
+    for (uint32_t i = 0; i < batch->count; i++) {
+      encoder->failed += !batch->written[i];
+    }
+    encoder->pending = NULL;
+    cnd_signal(&encoder->idle);
+  }
+  mtx_unlock(&encoder->lock);
+  return 0;
+}
+
+// Blocks until the previous batch is written
+static void encoder_wait(Encoder *encoder) {
+  mtx_lock(&encoder->lock);
+  while (encoder->pending) {
+    cnd_wait(&encoder->idle, &encoder->lock);
+  }
+  mtx_unlock(&encoder->lock);
+}
+
+static void encoder_submit(Encoder *encoder, ExportBatch *batch) {
+  encoder_wait(encoder);
+  mtx_lock(&encoder->lock);
+  encoder->pending = batch;
+  cnd_signal(&encoder->wake);
+  mtx_unlock(&encoder->lock);
+}
+
+// Maps the world box to the whole image, keeping the aspect ratio
+static void canvas_fit(Canvas *canvas, const vec2 min, const vec2 max, float margin) {
+  float width = fmaxf(max[0] - min[0], 1e-6f);
+  float height = fmaxf(max[1] - min[1], 1e-6f);
+  canvas->scale = fminf(canvas->width / width, canvas->height / height) * (1.0f - 2.0f * margin);
+  // Screen = scale * world - position, relative to the image center
+  canvas->position[0] = canvas->scale * (min[0] + max[0]) * 0.5f;
+  canvas->position[1] = canvas->scale * (min[1] + max[1]) * 0.5f;
+  canvas_update_transform(canvas);
+}
+
+// World-space endpoints of every Line in the world, like the renderer gathers them
+static void gather_lines(ecs_world_t *world, ecs_query_t *query, LineBatch *lines) {
+  lines->count = 0;
+  ecs_iter_t it = ecs_query_iter(world, query);
+  while (ecs_query_next(&it)) {
+    const Line *line = ecs_field(&it, Line, 0);
+    const Position *position = ecs_field(&it, Position, 1);
+    for (int i = 0; i < it.count; i++) {
+      vec2 a, b;
+      glm_vec2_add((float *)line[i].a, (float *)position[i].pos, a);
+      glm_vec2_add((float *)line[i].b, (float *)position[i].pos, b);
+      line_batch_push(lines, a, b);
+    }
+  }
+}
+
+static void render_view(DrawContext *ctx, Surface *surface, const LineBatch *world_lines, LineBatch *view_lines) {
+  // draw_context_lines transforms in place, every view starts from the world-space copy
+  line_batch_reserve(view_lines, world_lines->count);
+  memcpy(view_lines->x0, world_lines->x0, world_lines->count * sizeof(float));
+  memcpy(view_lines->y0, world_lines->y0, world_lines->count * sizeof(float));
+  memcpy(view_lines->x1, world_lines->x1, world_lines->count * sizeof(float));
+  memcpy(view_lines->y1, world_lines->y1, world_lines->count * sizeof(float));
+  view_lines->count = world_lines->count;
+
+  ctx->surface = *surface;
+  rasterizer_clear_surface(&ctx->surface);
+  draw_context_begin(ctx);
+  draw_context_lines(ctx, view_lines, LINE_THICKNESS * ctx->canvas.scale);
+  draw_context_flush(ctx);
+}
+
+// File name without directory and extension, as printf precision and string
+static int scene_stem(const char *path, const char **stem) {
+  const char *slash = strrchr(path, '/');
+  *stem = slash ? slash + 1 : path;
+  const char *dot = strrchr(*stem, '.');
+  return dot && dot != *stem ? (int)(dot - *stem) : (int)strlen(*stem);
+}
+
+static bool parse_args(int argc, char **argv, ExportConfig *config, int *first_scene) {
+  int i = 1;
+  for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      if (sscanf(argv[++i], "%ux%u", &config->width, &config->height) != 2 || config->width == 0 || config->height == 0)
+        return false;
+    } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+      char *end;
+      long grid = strtol(argv[++i], &end, 10);
+      if (end == argv[i] || *end != '\0' || grid <= 0 || grid > EXPORT_MAX_GRID)
+        return false;
+      config->grid = (int)grid;
+    } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "qoi") == 0) {
+        config->format = IMAGE_FORMAT_QOI;
+      } else if (strcmp(argv[i], "ppm") == 0) {
+        config->format = IMAGE_FORMAT_PPM;
+      } else {
+        return false;
+      }
+    } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      config->out_dir = argv[++i];
+    } else {
+      return false;
+    }
+  }
+  *first_scene = i;
+  return i < argc;
+}
+
+int main(int argc, char **argv) {
+  ExportConfig config = {.width = 256, .height = 256, .format = IMAGE_FORMAT_QOI, .out_dir = "."};
+  int first_scene;
+  if (!parse_args(argc, argv, &config, &first_scene)) {
+    fprintf(stderr, "usage: %s [--size <w>x<h>] [--grid <n>] [--format qoi|ppm] [--out <dir>] scene.bin...\n", argv[0]);
+    return 1;
+  }
+
+  ecs_world_t *world = ecs_init();
+  ECS_COMPONENT_DEFINE(world, Position);
+  ECS_COMPONENT_DEFINE(world, Line);
+  ecs_query_t *query = ecs_query(world, {.terms = {{ecs_id(Line), .inout = EcsIn}, {ecs_id(Position), .inout = EcsIn}}});
+
+  // The pool only encodes, rasterization stays on this thread
+  Encoder encoder = {.pool = thread_pool_create(0)};
+  mtx_init(&encoder.lock, mtx_plain);
+  cnd_init(&encoder.wake);
+  cnd_init(&encoder.idle);
+  if (thrd_create(&encoder.thread, encoder_main, &encoder) != thrd_success) {
+    fprintf(stderr, "can't start the encoder thread\n");
+    thread_pool_destroy(encoder.pool);
+    return 1;
+  }
+
+  ExportBatch *batches = calloc(2, sizeof(ExportBatch));
+  for (int b = 0; b < 2; b++) {
+    batches[b].format = config.format;
+    for (int i = 0; i < EXPORT_BATCH; i++) {
+      rasterizer_surface_resize(&batches[b].surfaces[i], config.width, config.height);
+      rasterizer_set_clear_color(&batches[b].surfaces[i], (ColorF){.r = 1.0f, .g = 1.0f, .b = 1.0f, .a = 1.0f});
+    }
+  }
+  ExportBatch *batch = &batches[0];
+
+  DrawContext ctx = {0};
+  draw_context_set_color(&ctx, (ColorF){.r = 0.0f, .g = 0.0f, .b = 1.0f, .a = 1.0f});
+  LineBatch world_lines = {0}, view_lines = {0};
+
+  uint64_t start = clock_now_ns();
+  uint64_t rasterize_ns = 0;
+  uint32_t images = 0, failed_scenes = 0;
+  for (int s = first_scene; s < argc; s++) {
+    SceneFile scene;
+    if (!scene_file_open(&scene, argv[s])) {
+      fprintf(stderr, "can't open scene %s\n", argv[s]);
+      failed_scenes++;
+      continue;
+    }
+    vec2 min = {scene.header->bounds_min[0], scene.header->bounds_min[1]};
+    vec2 max = {scene.header->bounds_max[0], scene.header->bounds_max[1]};
+    scene_file_spawn(world, &scene, 0, scene.line_count);
+    scene_file_close(&scene);
+    gather_lines(world, query, &world_lines);
+    ecs_delete_with(world, ecs_id(Line));
+    if (min[0] > max[0]) {
+      // Empty scene, still gets its images
+      glm_vec2_zero(min);
+      glm_vec2_zero(max);
+    }
+
+    int view_count = 1 + config.grid * config.grid;
+    for (int v = 0; v < view_count; v++) {
+      uint64_t view_start = clock_now_ns();
+      canvas_init(&ctx.canvas, (float)config.width, (float)config.height);
+      if (v == 0) {
+        canvas_fit(&ctx.canvas, min, max, EXPORT_MARGIN);
+      } else {
+        // Row major cells of the bounds
+        int cell = v - 1;
+        vec2 size = {(max[0] - min[0]) / config.grid, (max[1] - min[1]) / config.grid};
+        vec2 cell_min = {min[0] + size[0] * (cell % config.grid), min[1] + size[1] * (cell / config.grid)};
+        vec2 cell_max = {cell_min[0] + size[0], cell_min[1] + size[1]};
+        canvas_fit(&ctx.canvas, cell_min, cell_max, 0.0f);
+      }
+
+      const char *stem;
+      int stem_length = scene_stem(argv[s], &stem);
+      uint32_t slot = batch->count++;
+      snprintf(batch->paths[slot], EXPORT_PATH_MAX, "%s/%.*s_%d.%s", config.out_dir, stem_length, stem, v, image_format_extension(config.format));
+      render_view(&ctx, &batch->surfaces[slot], &world_lines, &view_lines);
+      rasterize_ns += clock_now_ns() - view_start;
+      images++;
+
+      if (batch->count == EXPORT_BATCH) {
+        encoder_submit(&encoder, batch);
+        batch = batch == &batches[0] ? &batches[1] : &batches[0];
+        batch->count = 0;
+      }
+    }
+  }
+  if (batch->count > 0) {
+    encoder_submit(&encoder, batch);
+  }
+  encoder_wait(&encoder);
+  double seconds = (clock_now_ns() - start) / 1e9;
+
+  printf("{\"images\": %u, \"failed_images\": %u, \"failed_scenes\": %u, \"seconds\": %.3f, \"rasterize_seconds\": %.3f, "
+         "\"images_per_second\": %.1f}\n",
+         images, encoder.failed, failed_scenes, seconds, rasterize_ns / 1e9, seconds > 0.0 ? images / seconds : 0.0);
+
+  mtx_lock(&encoder.lock);
+  encoder.quit = true;
+  cnd_signal(&encoder.wake);
+  mtx_unlock(&encoder.lock);
+  thrd_join(encoder.thread, NULL);
+  thread_pool_destroy(encoder.pool);
+  cnd_destroy(&encoder.wake);
+  cnd_destroy(&encoder.idle);
+  mtx_destroy(&encoder.lock);
+
+  for (int b = 0; b < 2; b++) {
+    for (int i = 0; i < EXPORT_BATCH; i++) {
+      rasterizer_surface_free(&batches[b].surfaces[i]);
+    }
+  }
+  free(batches);
+  draw_context_free(&ctx);
+  line_batch_free(&world_lines);
+  line_batch_free(&view_lines);
+  ecs_query_fini(query);
+  ecs_fini(world);
+  return encoder.failed || failed_scenes ? 1 : 0;
+}
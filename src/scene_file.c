@@ -0,0 +1,242 @@
+#include "scene_file.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Scene files are read in place, only little-endian hosts are supported"
+#endif
+
+// Entities per ecs_bulk_init call, bounds the staging arrays
+#define SCENE_SPAWN_BATCH 16384
+// Sections before color are the floats every writer fills
+#define SCENE_FLOAT_SECTIONS SCENE_SECTION_COLOR
+
+static uint64_t align_up(uint64_t value) { return (value + SCENE_FILE_ALIGN - 1) & ~(uint64_t)(SCENE_FILE_ALIGN - 1); }
+
+static bool section_valid(const SceneHeader *header, size_t file_size, SceneSection section) {
+  uint64_t offset = header->sections[section];
+  uint64_t bytes = header->line_count * sizeof(float);
+  return offset != 0 && offset % SCENE_FILE_ALIGN == 0 && offset <= file_size && bytes <= file_size - offset;
+}
+
+// Read-only view of the whole file, NULL when it can't be mapped or is too small for a header
+static void *map_file(const char *path, size_t *size) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return NULL;
+
+  void *map = NULL;
+  LARGE_INTEGER file_size;
+  if (GetFileSizeEx(file, &file_size) && (uint64_t)file_size.QuadPart >= sizeof(SceneHeader) && (uint64_t)file_size.QuadPart <= SIZE_MAX) {
+    // The view stays valid once both handles are closed
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping) {
+      map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+    }
+    *size = (size_t)file_size.QuadPart;
+  }
+  CloseHandle(file);
+  return map;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SceneHeader)) {
+    close(fd);
+    return NULL;
+  }
+  *size = (size_t)st.st_size;
+  void *map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  return map == MAP_FAILED ? NULL : map;
+#endif
+}
+
+static void unmap_file(void *map, size_t size) {
+#ifdef _WIN32
+  (void)size;
+  UnmapViewOfFile(map);
+#else
+  munmap(map, size);
+#endif
+}
+
+void scene_file_advise(const SceneFile *scene, bool sequential) {
+#ifdef _WIN32
+  // Views take no access hints, the page cache reads ahead on its own
+  (void)scene;
+  (void)sequential;
+#else
+  madvise(scene->map, scene->map_size, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+#endif
+}
+
+bool scene_file_open(SceneFile *scene, const char *path) {
+  *scene = (SceneFile){0};
+  size_t size = 0;
+  void *map = map_file(path, &size);
+  if (!map)
+    return false;
+
+  const SceneHeader *header = map;
+  bool valid = memcmp(header->magic, SCENE_FILE_MAGIC, sizeof(header->magic)) == 0 && header->version == SCENE_FILE_VERSION &&
+               header->header_size == sizeof(SceneHeader) && header->line_count <= size / sizeof(float);
+  for (int s = 0; s < SCENE_SECTION_COUNT && valid; s++) {
+    // Color is the only optional section
+    if (s == SCENE_SECTION_COLOR && header->sections[s] == 0)
+      continue;
+    valid = section_valid(header, size, s);
+  }
+  if (!valid) {
+    unmap_file(map, size);
+    return false;
+  }
+
+  const uint8_t *base = map;
+  scene->header = header;
+  scene->line_count = header->line_count;
+  scene->x0 = (const float *)(base + header->sections[SCENE_SECTION_X0]);
+  scene->y0 = (const float *)(base + header->sections[SCENE_SECTION_Y0]);
+  scene->x1 = (const float *)(base + header->sections[SCENE_SECTION_X1]);
+  scene->y1 = (const float *)(base + header->sections[SCENE_SECTION_Y1]);
+  scene->thickness = (const float *)(base + header->sections[SCENE_SECTION_THICKNESS]);
+  scene->position_x = (const float *)(base + header->sections[SCENE_SECTION_POSITION_X]);
+  scene->position_y = (const float *)(base + header->sections[SCENE_SECTION_POSITION_Y]);
+  scene->color = header->sections[SCENE_SECTION_COLOR] ? (const uint32_t *)(base + header->sections[SCENE_SECTION_COLOR]) : NULL;
+  scene->map = map;
+  scene->map_size = size;
+  // Read front to back by the loaders
+  scene_file_advise(scene, true);
+  return true;
+}
+
+void scene_file_close(SceneFile *scene) {
+  if (scene->map) {
+    unmap_file(scene->map, scene->map_size);
+  }
+  *scene = (SceneFile){0};
+}
+
+void scene_file_read(const SceneFile *scene, uint64_t first, uint32_t count, Line *lines, Position *positions) {
+  // Sections to component layout, the only per-line work
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t at = first + i;
+    lines[i] = (Line){
+        .a = {scene->x0[at], scene->y0[at]},
+        .b = {scene->x1[at], scene->y1[at]},
+        .thickness = scene->thickness[at],
+    };
+    positions[i] = (Position){.pos = {scene->position_x[at], scene->position_y[at]}};
+  }
+}
+
+void scene_file_spawn(ecs_world_t *world, const SceneFile *scene, uint64_t first, uint64_t count) {
+  if (first >= scene->line_count)
+    return;
+  count = count < scene->line_count - first ? count : scene->line_count - first;
+
+  Line *lines = malloc(SCENE_SPAWN_BATCH * sizeof(Line));
+  Position *positions = malloc(SCENE_SPAWN_BATCH * sizeof(Position));
+  for (uint64_t done = 0; done < count;) {
+    uint32_t n = count - done < SCENE_SPAWN_BATCH ? (uint32_t)(count - done) : SCENE_SPAWN_BATCH;
+    scene_file_read(scene, first + done, n, lines, positions);
+    ecs_bulk_init(world, &(ecs_bulk_desc_t){
+                             .count = (int32_t)n,
+                             .ids = {ecs_id(Line), ecs_id(Position)},
+                             .data = (void *[]){lines, positions},
+                         });
+    done += n;
+  }
+  free(lines);
+  free(positions);
+}
+
+bool scene_file_load(ecs_world_t *world, const char *path) {
+  SceneFile scene;
+  if (!scene_file_open(&scene, path))
+    return false;
+  scene_file_spawn(world, &scene, 0, scene.line_count);
+  scene_file_close(&scene);
+  return true;
+}
+
+// Zeros up to the next aligned offset
+static bool write_padding(FILE *file, uint64_t written) {
+  static const uint8_t zeros[SCENE_FILE_ALIGN];
+  uint64_t padding = align_up(written) - written;
+  return padding == 0 || fwrite(zeros, 1, padding, file) == padding;
+}
+
+bool scene_file_write(ecs_world_t *world, const char *path) {
+  ecs_query_t *query = ecs_query(world, {.terms = {{ecs_id(Line), .inout = EcsIn}, {ecs_id(Position), .inout = EcsIn}}});
+
+  uint64_t count = 0;
+  ecs_iter_t it = ecs_query_iter(world, query);
+  while (ecs_query_next(&it)) {
+    count += it.count;
+  }
+
+  // One array per float section, in section order
+  float *sections = malloc((count ? count : 1) * SCENE_FLOAT_SECTIONS * sizeof(float));
+  SceneHeader header = {.version = SCENE_FILE_VERSION, .header_size = sizeof(SceneHeader), .line_count = count};
+  memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+  header.bounds_min[0] = header.bounds_min[1] = INFINITY;
+  header.bounds_max[0] = header.bounds_max[1] = -INFINITY;
+
+  uint64_t i = 0;
+  it = ecs_query_iter(world, query);
+  while (ecs_query_next(&it)) {
+    const Line *line = ecs_field(&it, Line, 0);
+    const Position *position = ecs_field(&it, Position, 1);
+    for (int k = 0; k < it.count; k++, i++) {
+      float values[SCENE_FLOAT_SECTIONS] = {
+          line[k].a[0], line[k].a[1], line[k].b[0], line[k].b[1], line[k].thickness, position[k].pos[0], position[k].pos[1],
+      };
+      for (int s = 0; s < SCENE_FLOAT_SECTIONS; s++) {
+        sections[s * count + i] = values[s];
+      }
+
+      LineBounds bounds;
+      line_world_bounds(&line[k], &position[k], &bounds);
+      header.bounds_min[0] = fminf(header.bounds_min[0], bounds.min[0]);
+      header.bounds_min[1] = fminf(header.bounds_min[1], bounds.min[1]);
+      header.bounds_max[0] = fmaxf(header.bounds_max[0], bounds.max[0]);
+      header.bounds_max[1] = fmaxf(header.bounds_max[1], bounds.max[1]);
+    }
+  }
+  ecs_query_fini(query);
+
+  uint64_t section_bytes = count * sizeof(float);
+  uint64_t offset = align_up(sizeof(SceneHeader));
+  for (int s = 0; s < SCENE_FLOAT_SECTIONS; s++) {
+    header.sections[s] = offset;
+    offset += align_up(section_bytes);
+  }
+
+  FILE *file = fopen(path, "wb");
+  bool ok = file != NULL;
+  ok = ok && fwrite(&header, sizeof(header), 1, file) == 1 && write_padding(file, sizeof(header));
+  for (int s = 0; s < SCENE_FLOAT_SECTIONS && ok; s++) {
+    ok = fwrite(sections + s * count, sizeof(float), count, file) == count && write_padding(file, section_bytes);
+  }
+  if (file) {
+    ok = fclose(file) == 0 && ok;
+  }
+  free(sections);
+  return ok;
+}
@@ -0,0 +1,77 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include "components.h"
+#include "flecs.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary scene of Line + Position entities, read in place from a memory mapping.
+//
+//   SceneHeader, then one SCENE_FILE_ALIGN aligned little-endian array per section,
+//   line_count elements each. Absent sections have offset 0.
+//
+// Readers reject other versions, new sections bump it.
+#define SCENE_FILE_MAGIC "CSBSCENE"
+#define SCENE_FILE_VERSION 1
+#define SCENE_FILE_ALIGN 64
+
+typedef enum {
+  SCENE_SECTION_X0, // float, Line.a relative to the position
+  SCENE_SECTION_Y0,
+  SCENE_SECTION_X1, // float, Line.b
+  SCENE_SECTION_Y1,
+  SCENE_SECTION_THICKNESS, // float
+  SCENE_SECTION_POSITION_X, // float
+  SCENE_SECTION_POSITION_Y,
+  SCENE_SECTION_COLOR, // Packed ARGB, optional and not drawn yet
+  SCENE_SECTION_COUNT,
+} SceneSection;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t line_count;
+  // World space, strokes included. Empty scenes have min > max.
+  float bounds_min[2];
+  float bounds_max[2];
+  uint64_t sections[SCENE_SECTION_COUNT]; // Byte offsets from the start of the file
+} SceneHeader;
+
+typedef struct {
+  const SceneHeader *header;
+  uint64_t line_count;
+  const float *x0;
+  const float *y0;
+  const float *x1;
+  const float *y1;
+  const float *thickness;
+  const float *position_x;
+  const float *position_y;
+  const uint32_t *color; // NULL when the file has none
+
+  void *map;
+  size_t map_size;
+} SceneFile;
+
+// Maps and validates the file, false when it can't be read or isn't a scene of this version
+bool scene_file_open(SceneFile *scene, const char *path);
+void scene_file_close(SceneFile *scene);
+// Read-ahead hint for the mapping, scene_file_open starts out sequential
+void scene_file_advise(const SceneFile *scene, bool sequential);
+
+// Lines [first, first + count) in component layout, the range must be in the file
+void scene_file_read(const SceneFile *scene, uint64_t first, uint32_t count, Line *lines, Position *positions);
+
+// Creates the entities of lines [first, first + count) in batches with ecs_bulk_init
+void scene_file_spawn(ecs_world_t *world, const SceneFile *scene, uint64_t first, uint64_t count);
+
+// Opens, spawns every line and closes
+bool scene_file_load(ecs_world_t *world, const char *path);
+
+// Every entity with Line and Position, colors are left out
+bool scene_file_write(ecs_world_t *world, const char *path);
+
+#endif // SCENE_FILE_H
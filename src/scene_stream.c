@@ -0,0 +1,234 @@
+#include "scene_stream.h"
+#include "clock.h"
+#include "components.h"
+#include "scene_file.h"
+#include "spsc_queue.h"
+#include <float.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <threads.h>
+
+// One chunk converted to component layout
+typedef struct {
+  Line *lines;
+  Position *positions;
+  uint32_t count;
+} StreamSlot;
+
+struct SceneStream {
+  thrd_t thread;
+  SceneFile scene;
+  uint32_t chunk_count;
+
+  // Slot indices, loader -> main once filled and main -> loader once inserted.
+  // There are as many slots as either queue holds, so pushes never fail.
+  StreamSlot slots[SPSC_QUEUE_CAPACITY];
+  SpscQueue ready;
+  SpscQueue free;
+
+  // Guards focus, otherwise only for sleeping
+  mtx_t lock;
+  cnd_t wake;
+  vec2 focus;
+  atomic_bool quit;
+  atomic_bool finished; // Every chunk is in ready or already inserted
+
+  // Loader thread only, world-space box per chunk
+  vec2 *chunk_min;
+  vec2 *chunk_max;
+  bool *chunk_taken;
+
+  // Main thread only
+  int current; // Slot being inserted, -1 for none
+  uint32_t current_offset;
+  uint64_t inserted;
+};
+
+static void compute_chunk_boxes(SceneStream *stream) {
+  const SceneFile *scene = &stream->scene;
+  for (uint32_t c = 0; c < stream->chunk_count && !atomic_load(&stream->quit); c++) {
+    uint64_t first = (uint64_t)c * SCENE_STREAM_CHUNK;
+    uint64_t end = first + SCENE_STREAM_CHUNK < scene->line_count ? first + SCENE_STREAM_CHUNK : scene->line_count;
+    vec2 min = {FLT_MAX, FLT_MAX}, max = {-FLT_MAX, -FLT_MAX};
+    for (uint64_t i = first; i < end; i++) {
+      float px = scene->position_x[i], py = scene->position_y[i];
+      min[0] = fminf(min[0], px + fminf(scene->x0[i], scene->x1[i]));
+      min[1] = fminf(min[1], py + fminf(scene->y0[i], scene->y1[i]));
+      max[0] = fmaxf(max[0], px + fmaxf(scene->x0[i], scene->x1[i]));
+      max[1] = fmaxf(max[1], py + fmaxf(scene->y0[i], scene->y1[i]));
+    }
+    glm_vec2_copy(min, stream->chunk_min[c]);
+    glm_vec2_copy(max, stream->chunk_max[c]);
+  }
+}
+
+// Remaining chunk whose box is closest to focus
+static uint32_t nearest_chunk(SceneStream *stream, const vec2 focus) {
+  uint32_t best = 0;
+  float best_distance = INFINITY;
+  for (uint32_t c = 0; c < stream->chunk_count; c++) {
+    if (stream->chunk_taken[c])
+      continue;
+    float dx = fmaxf(fmaxf(stream->chunk_min[c][0] - focus[0], focus[0] - stream->chunk_max[c][0]), 0.0f);
+    float dy = fmaxf(fmaxf(stream->chunk_min[c][1] - focus[1], focus[1] - stream->chunk_max[c][1]), 0.0f);
+    float distance = dx * dx + dy * dy;
+    if (distance < best_distance) {
+      best_distance = distance;
+      best = c;
+    }
+  }
+  return best;
+}
+
+static int scene_stream_main(void *arg) {
+  SceneStream *stream = arg;
+  const SceneFile *scene = &stream->scene;
+
+  // One sequential pass, chunks are then read in focus order
+  compute_chunk_boxes(stream);
+  scene_file_advise(scene, false);
+
+  for (uint32_t remaining = stream->chunk_count; remaining > 0; remaining--) {
+    uint32_t index;
+    vec2 focus;
+    mtx_lock(&stream->lock);
+    while (!atomic_load(&stream->quit) && !spsc_queue_pop(&stream->free, &index)) {
+      cnd_wait(&stream->wake, &stream->lock);
+    }
+    glm_vec2_copy(stream->focus, focus);
+    mtx_unlock(&stream->lock);
+    if (atomic_load(&stream->quit))
+      break;
+
+    // Picked as late as possible, so it follows the viewport while loading
+    uint32_t c = nearest_chunk(stream, focus);
+    stream->chunk_taken[c] = true;
+    uint64_t first = (uint64_t)c * SCENE_STREAM_CHUNK;
+    StreamSlot *slot = &stream->slots[index];
+    slot->count = scene->line_count - first < SCENE_STREAM_CHUNK ? (uint32_t)(scene->line_count - first) : SCENE_STREAM_CHUNK;
+    scene_file_read(scene, first, slot->count, slot->lines, slot->positions);
+    spsc_queue_push(&stream->ready, index);
+  }
+
+  atomic_store(&stream->finished, true);
+  return 0;
+}
+
+SceneStream *scene_stream_open(const char *path) {
+  SceneStream *stream = calloc(1, sizeof(SceneStream));
+  if (!scene_file_open(&stream->scene, path)) {
+    free(stream);
+    return NULL;
+  }
+
+  stream->chunk_count = (uint32_t)((stream->scene.line_count + SCENE_STREAM_CHUNK - 1) / SCENE_STREAM_CHUNK);
+  stream->chunk_min = malloc((stream->chunk_count ? stream->chunk_count : 1) * sizeof(vec2));
+  stream->chunk_max = malloc((stream->chunk_count ? stream->chunk_count : 1) * sizeof(vec2));
+  stream->chunk_taken = calloc(stream->chunk_count ? stream->chunk_count : 1, sizeof(bool));
+  stream->current = -1;
+
+  spsc_queue_init(&stream->ready);
+  spsc_queue_init(&stream->free);
+  for (uint32_t i = 0; i < SPSC_QUEUE_CAPACITY; i++) {
+    stream->slots[i].lines = malloc(SCENE_STREAM_CHUNK * sizeof(Line));
+    stream->slots[i].positions = malloc(SCENE_STREAM_CHUNK * sizeof(Position));
+    spsc_queue_push(&stream->free, i);
+  }
+
+  mtx_init(&stream->lock, mtx_plain);
+  cnd_init(&stream->wake);
+  atomic_init(&stream->quit, false);
+  atomic_init(&stream->finished, false);
+
+  if (thrd_create(&stream->thread, scene_stream_main, stream) != thrd_success) {
+    cnd_destroy(&stream->wake);
+    mtx_destroy(&stream->lock);
+    for (uint32_t i = 0; i < SPSC_QUEUE_CAPACITY; i++) {
+      free(stream->slots[i].lines);
+      free(stream->slots[i].positions);
+    }
+    free(stream->chunk_min);
+    free(stream->chunk_max);
+    free(stream->chunk_taken);
+    scene_file_close(&stream->scene);
+    free(stream);
+    return NULL;
+  }
+  return stream;
+}
+
+void scene_stream_destroy(SceneStream *stream) {
+  if (!stream)
+    return;
+
+  mtx_lock(&stream->lock);
+  atomic_store(&stream->quit, true);
+  cnd_signal(&stream->wake);
+  mtx_unlock(&stream->lock);
+  thrd_join(stream->thread, NULL);
+
+  for (uint32_t i = 0; i < SPSC_QUEUE_CAPACITY; i++) {
+    free(stream->slots[i].lines);
+    free(stream->slots[i].positions);
+  }
+  free(stream->chunk_min);
+  free(stream->chunk_max);
+  free(stream->chunk_taken);
+  scene_file_close(&stream->scene);
+  cnd_destroy(&stream->wake);
+  mtx_destroy(&stream->lock);
+  free(stream);
+}
+
+void scene_stream_set_focus(SceneStream *stream, const vec2 focus) {
+  mtx_lock(&stream->lock);
+  glm_vec2_copy((float *)focus, stream->focus);
+  mtx_unlock(&stream->lock);
+}
+
+uint32_t scene_stream_pump(SceneStream *stream, ecs_world_t *world, uint64_t budget_ns) {
+  uint64_t start = clock_now_ns();
+  uint32_t inserted = 0;
+  for (;;) {
+    if (stream->current < 0) {
+      uint32_t index;
+      if (!spsc_queue_pop(&stream->ready, &index))
+        break;
+      stream->current = (int)index;
+      stream->current_offset = 0;
+    }
+
+    StreamSlot *slot = &stream->slots[stream->current];
+    uint32_t n = slot->count - stream->current_offset < SCENE_STREAM_STEP ? slot->count - stream->current_offset : SCENE_STREAM_STEP;
+    ecs_bulk_init(world, &(ecs_bulk_desc_t){
+                             .count = (int32_t)n,
+                             .ids = {ecs_id(Line), ecs_id(Position)},
+                             .data = (void *[]){slot->lines + stream->current_offset, slot->positions + stream->current_offset},
+                         });
+    stream->current_offset += n;
+    inserted += n;
+
+    if (stream->current_offset == slot->count) {
+      spsc_queue_push(&stream->free, (uint32_t)stream->current);
+      stream->current = -1;
+      mtx_lock(&stream->lock);
+      cnd_signal(&stream->wake);
+      mtx_unlock(&stream->lock);
+    }
+    if (clock_now_ns() - start >= budget_ns)
+      break;
+  }
+  stream->inserted += inserted;
+  return inserted;
+}
+
+bool scene_stream_done(const SceneStream *stream) {
+  // finished is stored after the last push, so ready is complete once it is seen
+  return atomic_load((atomic_bool *)&stream->finished) && stream->current < 0 && spsc_queue_empty((SpscQueue *)&stream->ready);
+}
+
+void scene_stream_progress(const SceneStream *stream, uint64_t *inserted, uint64_t *total) {
+  *inserted = stream->inserted;
+  *total = stream->scene.line_count;
+}
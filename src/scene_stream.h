@@ -0,0 +1,30 @@
+#ifndef SCENE_STREAM_H
+#define SCENE_STREAM_H
+
+#include "flecs.h"
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lines per chunk, the unit the loader thread orders and converts
+#define SCENE_STREAM_CHUNK 8192
+// Entities per ecs_bulk_init while pumping, the budget is checked in between
+#define SCENE_STREAM_STEP 1024
+
+// Scene file loaded in the background. The loader thread converts chunks nearest
+// the focus point first into component arrays, the main thread inserts them.
+typedef struct SceneStream SceneStream;
+
+// NULL when the file can't be opened as a scene, see scene_file_open
+SceneStream *scene_stream_open(const char *path);
+// Stops the loader, lines not inserted yet are dropped
+void scene_stream_destroy(SceneStream *stream);
+
+// Main thread side. World-space point the loader sorts the remaining chunks by, usually the viewport center.
+void scene_stream_set_focus(SceneStream *stream, const vec2 focus);
+// Inserts converted lines until budget_ns has passed, at least one step when any is ready. Returns the count.
+uint32_t scene_stream_pump(SceneStream *stream, ecs_world_t *world, uint64_t budget_ns);
+bool scene_stream_done(const SceneStream *stream);
+void scene_stream_progress(const SceneStream *stream, uint64_t *inserted, uint64_t *total);
+
+#endif // SCENE_STREAM_H
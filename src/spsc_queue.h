@@ -0,0 +1,50 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SPSC_QUEUE_CAPACITY 8 // Power of two
+
+// Lock-free queue of indices between exactly one producer and one consumer thread.
+// head and tail only ever grow, each one is written by a single side.
+typedef struct {
+  uint32_t items[SPSC_QUEUE_CAPACITY];
+  alignas(64) atomic_uint head; // Consumer
+  alignas(64) atomic_uint tail; // Producer
+} SpscQueue;
+
+static inline void spsc_queue_init(SpscQueue *queue) {
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+}
+
+// Producer side, false when full
+static inline bool spsc_queue_push(SpscQueue *queue, uint32_t value) {
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+  if (tail - head == SPSC_QUEUE_CAPACITY)
+    return false;
+  queue->items[tail & (SPSC_QUEUE_CAPACITY - 1)] = value;
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+// Consumer side, false when empty
+static inline bool spsc_queue_pop(SpscQueue *queue, uint32_t *value) {
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+  if (head == tail)
+    return false;
+  *value = queue->items[head & (SPSC_QUEUE_CAPACITY - 1)];
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  return true;
+}
+
+static inline bool spsc_queue_empty(SpscQueue *queue) {
+  return atomic_load_explicit(&queue->head, memory_order_acquire) == atomic_load_explicit(&queue->tail, memory_order_acquire);
+}
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,149 @@
+#include "thread_pool.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <threads.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+struct ThreadPool {
+  thrd_t *workers;
+  uint32_t worker_count;
+
+  mtx_t lock;
+  cnd_t work_ready;
+  cnd_t work_done;
+  uint64_t generation;
+  uint32_t finished;
+  bool quit;
+
+  // Current job
+  ThreadPoolTask task;
+  void *ctx;
+  uint32_t count;
+  atomic_uint next;
+};
+
+uint32_t thread_pool_cpu_count(void) {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (uint32_t)info.dwNumberOfProcessors : 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (uint32_t)count : 1;
+#endif
+}
+
+static void run_items(ThreadPool *pool) {
+  for (;;) {
+    uint32_t index = atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed);
+    if (index >= pool->count)
+      break;
+    pool->task(pool->ctx, index);
+  }
+}
+
+static int worker_main(void *arg) {
+  ThreadPool *pool = arg;
+  uint64_t seen = 0;
+
+  for (;;) {
+    mtx_lock(&pool->lock);
+    while (!pool->quit && pool->generation == seen) {
+      cnd_wait(&pool->work_ready, &pool->lock);
+    }
+    if (pool->quit) {
+      mtx_unlock(&pool->lock);
+      return 0;
+    }
+    seen = pool->generation;
+    mtx_unlock(&pool->lock);
+
+    run_items(pool);
+
+    mtx_lock(&pool->lock);
+    if (++pool->finished == pool->worker_count) {
+      cnd_signal(&pool->work_done);
+    }
+    mtx_unlock(&pool->lock);
+  }
+}
+
+ThreadPool *thread_pool_create(uint32_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = thread_pool_cpu_count();
+  }
+
+  ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+  mtx_init(&pool->lock, mtx_plain);
+  cnd_init(&pool->work_ready);
+  cnd_init(&pool->work_done);
+  atomic_init(&pool->next, 0);
+
+  // The calling thread is one of the workers
+  pool->workers = calloc(thread_count, sizeof(thrd_t));
+  for (uint32_t i = 0; i + 1 < thread_count; i++) {
+    if (thrd_create(&pool->workers[i], worker_main, pool) != thrd_success)
+      break;
+    pool->worker_count++;
+  }
+  return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+  if (!pool)
+    return;
+
+  mtx_lock(&pool->lock);
+  pool->quit = true;
+  cnd_broadcast(&pool->work_ready);
+  mtx_unlock(&pool->lock);
+
+  for (uint32_t i = 0; i < pool->worker_count; i++) {
+    thrd_join(pool->workers[i], NULL);
+  }
+
+  cnd_destroy(&pool->work_ready);
+  cnd_destroy(&pool->work_done);
+  mtx_destroy(&pool->lock);
+  free(pool->workers);
+  free(pool);
+}
+
+uint32_t thread_pool_thread_count(const ThreadPool *pool) { return pool->worker_count + 1; }
+
+void thread_pool_parallel_for(ThreadPool *pool, uint32_t count, ThreadPoolTask task, void *ctx) {
+  if (count == 0)
+    return;
+
+  // Not worth waking anyone up
+  if (pool->worker_count == 0 || count == 1) {
+    for (uint32_t i = 0; i < count; i++) {
+      task(ctx, i);
+    }
+    return;
+  }
+
+  mtx_lock(&pool->lock);
+  pool->task = task;
+  pool->ctx = ctx;
+  pool->count = count;
+  pool->finished = 0;
+  atomic_store_explicit(&pool->next, 0, memory_order_relaxed);
+  pool->generation++;
+  cnd_broadcast(&pool->work_ready);
+  mtx_unlock(&pool->lock);
+
+  run_items(pool);
+
+  mtx_lock(&pool->lock);
+  while (pool->finished < pool->worker_count) {
+    cnd_wait(&pool->work_done, &pool->lock);
+  }
+  mtx_unlock(&pool->lock);
+}
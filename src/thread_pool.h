@@ -0,0 +1,21 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdint.h>
+
+typedef void (*ThreadPoolTask)(void *ctx, uint32_t index);
+
+typedef struct ThreadPool ThreadPool;
+
+uint32_t thread_pool_cpu_count(void);
+
+// thread_count counts the calling thread, 0 picks one per logical core
+ThreadPool *thread_pool_create(uint32_t thread_count);
+void thread_pool_destroy(ThreadPool *pool);
+uint32_t thread_pool_thread_count(const ThreadPool *pool);
+
+// Runs task(ctx, i) for every i in [0, count) and returns when all are done.
+// The caller takes part in the work, indices are handed out dynamically.
+void thread_pool_parallel_for(ThreadPool *pool, uint32_t count, ThreadPoolTask task, void *ctx);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,195 @@
+#include "tile_cache.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Same slack the renderer adds around lines for rounding and thin line runs
+#define TILE_CACHE_SLACK 2.0f
+
+#define TILE_BYTES ((size_t)TILE_CACHE_SIZE * TILE_CACHE_SIZE * sizeof(uint32_t))
+
+void tile_cache_init(TileCache *cache, size_t budget_bytes) {
+  *cache = (TileCache){0};
+  cache->capacity = budget_bytes / TILE_BYTES > 0 ? (uint32_t)(budget_bytes / TILE_BYTES) : 1;
+  cache->tiles = calloc(cache->capacity, sizeof(CachedTile));
+}
+
+void tile_cache_free(TileCache *cache) {
+  for (uint32_t i = 0; i < cache->capacity; i++) {
+    free(cache->tiles[i].pixels);
+  }
+  free(cache->tiles);
+  *cache = (TileCache){0};
+}
+
+void tile_cache_clear(TileCache *cache) {
+  for (uint32_t i = 0; i < cache->capacity; i++) {
+    cache->tiles[i].valid = false;
+  }
+  cache->valid_count = 0;
+}
+
+void tile_cache_set_state(TileCache *cache, RasterState state) {
+  const RasterState *old = &cache->state;
+  if (old->mode != state.mode || old->format != state.format || old->clear_color.r != state.clear_color.r || old->clear_color.g != state.clear_color.g ||
+      old->clear_color.b != state.clear_color.b || old->clear_color.a != state.clear_color.a) {
+    tile_cache_clear(cache);
+    cache->state = state;
+  }
+}
+
+void tile_cache_begin(TileCache *cache) {
+  cache->frame++;
+  cache->drawn = cache->reused = cache->scaled = 0;
+}
+
+CachedTile *tile_cache_find(TileCache *cache, float scale, int32_t x, int32_t y) {
+  for (uint32_t i = 0; i < cache->capacity; i++) {
+    CachedTile *tile = &cache->tiles[i];
+    if (tile->valid && tile->scale == scale && tile->x == x && tile->y == y) {
+      tile->last_used = cache->frame;
+      return tile;
+    }
+  }
+  return NULL;
+}
+
+// Empty slots go first, then invalid ones, then the least recently used
+static bool evict_before(const CachedTile *a, const CachedTile *b) {
+  int rank_a = !a->used ? 0 : (!a->valid ? 1 : 2);
+  int rank_b = !b->used ? 0 : (!b->valid ? 1 : 2);
+  return rank_a != rank_b ? rank_a < rank_b : a->last_used < b->last_used;
+}
+
+CachedTile *tile_cache_insert(TileCache *cache, float scale, int32_t x, int32_t y) {
+  CachedTile *slot = NULL;
+  bool own = false;
+  for (uint32_t i = 0; i < cache->capacity && !own; i++) {
+    CachedTile *tile = &cache->tiles[i];
+    own = tile->used && tile->scale == scale && tile->x == x && tile->y == y;
+    if (own || !slot || evict_before(tile, slot)) {
+      slot = tile;
+    }
+  }
+  // Everything is on screen this frame, evicting would only thrash
+  if (!own && slot->valid && slot->last_used == cache->frame)
+    return NULL;
+
+  if (!slot->pixels) {
+    slot->pixels = aligned_alloc(RASTERIZER_SURFACE_ALIGN, TILE_BYTES);
+  }
+  slot->scale = scale;
+  slot->x = x;
+  slot->y = y;
+  slot->used = true;
+  cache->valid_count -= slot->valid;
+  slot->valid = false;
+  slot->last_used = cache->frame;
+  return slot;
+}
+
+void tile_cache_set_valid(TileCache *cache, CachedTile *tile) {
+  cache->valid_count += !tile->valid;
+  tile->valid = true;
+}
+
+static void tile_world_box(const CachedTile *tile, float slack, vec2 min, vec2 max) {
+  float pad = slack / tile->scale;
+  min[0] = (float)tile->x * TILE_CACHE_SIZE / tile->scale - pad;
+  min[1] = (float)tile->y * TILE_CACHE_SIZE / tile->scale - pad;
+  max[0] = (float)(tile->x + 1) * TILE_CACHE_SIZE / tile->scale + pad;
+  max[1] = (float)(tile->y + 1) * TILE_CACHE_SIZE / tile->scale + pad;
+}
+
+static bool boxes_overlap(const vec2 a_min, const vec2 a_max, const vec2 b_min, const vec2 b_max) {
+  return a_max[0] >= b_min[0] && a_min[0] <= b_max[0] && a_max[1] >= b_min[1] && a_min[1] <= b_max[1];
+}
+
+void tile_cache_invalidate(TileCache *cache, const vec2 min, const vec2 max) {
+  if (!cache->valid_count)
+    return;
+  for (uint32_t i = 0; i < cache->capacity; i++) {
+    CachedTile *tile = &cache->tiles[i];
+    if (!tile->valid)
+      continue;
+    vec2 tile_min, tile_max;
+    tile_world_box(tile, TILE_CACHE_SLACK, tile_min, tile_max);
+    if (boxes_overlap(tile_min, tile_max, min, max)) {
+      tile->valid = false;
+      cache->valid_count--;
+    }
+  }
+}
+
+void tile_cache_blit(const CachedTile *tile, Surface *surface, int x, int y) {
+  Rect rect = rect_intersect((Rect){x, y, x + TILE_CACHE_SIZE, y + TILE_CACHE_SIZE}, rasterizer_surface_rect(surface));
+  if (rect_is_empty(rect))
+    return;
+  size_t bytes = (size_t)(rect.x1 - rect.x0) * sizeof(uint32_t);
+  for (int row = rect.y0; row < rect.y1; row++) {
+    const uint32_t *src = &tile->pixels[(size_t)(row - y) * TILE_CACHE_SIZE + (rect.x0 - x)];
+    memcpy(&surface->buffer[(size_t)row * surface->width + rect.x0], src, bytes);
+  }
+}
+
+static int clamp_texel(int v) { return v < 0 ? 0 : (v >= TILE_CACHE_SIZE ? TILE_CACHE_SIZE - 1 : v); }
+
+bool tile_cache_draw_scaled(TileCache *cache, Surface *surface, Rect dest, float scale, const vec2 origin) {
+  dest = rect_intersect(dest, rasterizer_surface_rect(surface));
+  if (rect_is_empty(dest))
+    return false;
+
+  vec2 dest_min = {(dest.x0 + origin[0]) / scale, (dest.y0 + origin[1]) / scale};
+  vec2 dest_max = {(dest.x1 + origin[0]) / scale, (dest.y1 + origin[1]) / scale};
+
+  // Closest zoom by ratio, either direction
+  float level = 0.0f;
+  float level_distance = INFINITY;
+  for (uint32_t i = 0; i < cache->capacity; i++) {
+    const CachedTile *tile = &cache->tiles[i];
+    if (!tile->valid || tile->scale == scale)
+      continue;
+    vec2 tile_min, tile_max;
+    tile_world_box(tile, 0.0f, tile_min, tile_max);
+    float distance = fabsf(logf(tile->scale / scale));
+    if (distance < level_distance && boxes_overlap(tile_min, tile_max, dest_min, dest_max)) {
+      level = tile->scale;
+      level_distance = distance;
+    }
+  }
+  if (level_distance == INFINITY)
+    return false;
+
+  // Level pixels per surface pixel
+  float ratio = level / scale;
+  for (uint32_t i = 0; i < cache->capacity; i++) {
+    CachedTile *tile = &cache->tiles[i];
+    if (!tile->valid || tile->scale != level)
+      continue;
+
+    // Surface pixels whose centers fall on the tile
+    float x0 = (float)tile->x * TILE_CACHE_SIZE / ratio - origin[0];
+    float y0 = (float)tile->y * TILE_CACHE_SIZE / ratio - origin[1];
+    float size = TILE_CACHE_SIZE / ratio;
+    Rect rect = {
+        (int)ceilf(x0 - 0.5f),
+        (int)ceilf(y0 - 0.5f),
+        (int)ceilf(x0 + size - 0.5f),
+        (int)ceilf(y0 + size - 0.5f),
+    };
+    rect = rect_intersect(rect, dest);
+    if (rect_is_empty(rect))
+      continue;
+
+    tile->last_used = cache->frame;
+    for (int y = rect.y0; y < rect.y1; y++) {
+      int v = clamp_texel((int)floorf((y + 0.5f + origin[1]) * ratio) - tile->y * TILE_CACHE_SIZE);
+      const uint32_t *src = &tile->pixels[(size_t)v * TILE_CACHE_SIZE];
+      uint32_t *row = &surface->buffer[(size_t)y * surface->width];
+      for (int x = rect.x0; x < rect.x1; x++) {
+        row[x] = src[clamp_texel((int)floorf((x + 0.5f + origin[0]) * ratio) - tile->x * TILE_CACHE_SIZE)];
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,66 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include "graphics/rasterizer.h"
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Tiles are square, in pixels of their zoom level
+#define TILE_CACHE_SIZE 256
+#define TILE_CACHE_DEFAULT_BUDGET ((size_t)64 << 20)
+
+// At zoom level scale, world point p lands on level pixel scale * p and tile (x, y)
+// covers level pixels [x, x + 1) * TILE_CACHE_SIZE on both axes. Levels are exact
+// canvas scales, so tiles drawn at one zoom are reused when panning at that zoom.
+typedef struct {
+  float scale;
+  int32_t x;
+  int32_t y;
+  uint32_t *pixels;
+  uint64_t last_used; // Frame, the oldest slot is evicted first
+  bool used;          // The slot holds this tile
+  bool valid;         // Pixels are current
+} CachedTile;
+
+typedef struct {
+  CachedTile *tiles;
+  uint32_t capacity;
+  uint32_t valid_count; // Tiles with valid set, invalidating is free while there are none
+  uint64_t frame;
+  // What the tiles were drawn with, see tile_cache_set_state
+  RasterState state;
+
+  // Last frame, for the debug panel
+  uint32_t drawn;
+  uint32_t reused;
+  uint32_t scaled;
+} TileCache;
+
+// As many tiles as fit in budget_bytes, at least one
+void tile_cache_init(TileCache *cache, size_t budget_bytes);
+void tile_cache_free(TileCache *cache);
+// Invalidates every tile
+void tile_cache_clear(TileCache *cache);
+// Tiles drawn with another mode, pixel format or clear color are dropped
+void tile_cache_set_state(TileCache *cache, RasterState state);
+// Starts a frame for the LRU and the stats
+void tile_cache_begin(TileCache *cache);
+
+// Valid tile or NULL, marks it used this frame
+CachedTile *tile_cache_find(TileCache *cache, float scale, int32_t x, int32_t y);
+// Slot to draw the tile into, its own if cached or else the least recently used one.
+// The caller marks it with tile_cache_set_valid once the pixels are drawn.
+CachedTile *tile_cache_insert(TileCache *cache, float scale, int32_t x, int32_t y);
+void tile_cache_set_valid(TileCache *cache, CachedTile *tile);
+// Drops the tiles of every level that can show something inside the world-space box
+void tile_cache_invalidate(TileCache *cache, const vec2 min, const vec2 max);
+
+// Copies the tile to the surface with its top left corner at (x, y), clipped
+void tile_cache_blit(const CachedTile *tile, Surface *surface, int x, int y);
+// Fills dest from the valid level closest to scale, nearest neighbour. origin is the level
+// pixel at the surface's top left corner. Pixels no tile covers are left alone, false when none did.
+bool tile_cache_draw_scaled(TileCache *cache, Surface *surface, Rect dest, float scale, const vec2 origin);
+
+#endif // TILE_CACHE_H
@@ -0,0 +1,156 @@
+#include "upload_ring.h"
+#include "SDL3/SDL_video.h"
+#include "clock.h"
+#include <stddef.h>
+#include <string.h>
+
+static PFNGLGENBUFFERSPROC gen_buffers;
+static PFNGLDELETEBUFFERSPROC delete_buffers;
+static PFNGLBINDBUFFERPROC bind_buffer;
+static PFNGLBUFFERDATAPROC buffer_data;
+static PFNGLBUFFERSTORAGEPROC buffer_storage;
+static PFNGLMAPBUFFERRANGEPROC map_buffer_range;
+static PFNGLUNMAPBUFFERPROC unmap_buffer;
+static PFNGLFENCESYNCPROC fence_sync;
+static PFNGLCLIENTWAITSYNCPROC client_wait_sync;
+static PFNGLDELETESYNCPROC delete_sync;
+
+static bool load_functions(void) {
+  gen_buffers = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress("glGenBuffers");
+  delete_buffers = (PFNGLDELETEBUFFERSPROC)SDL_GL_GetProcAddress("glDeleteBuffers");
+  bind_buffer = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress("glBindBuffer");
+  buffer_data = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress("glBufferData");
+  map_buffer_range = (PFNGLMAPBUFFERRANGEPROC)SDL_GL_GetProcAddress("glMapBufferRange");
+  unmap_buffer = (PFNGLUNMAPBUFFERPROC)SDL_GL_GetProcAddress("glUnmapBuffer");
+  fence_sync = (PFNGLFENCESYNCPROC)SDL_GL_GetProcAddress("glFenceSync");
+  client_wait_sync = (PFNGLCLIENTWAITSYNCPROC)SDL_GL_GetProcAddress("glClientWaitSync");
+  delete_sync = (PFNGLDELETESYNCPROC)SDL_GL_GetProcAddress("glDeleteSync");
+
+  buffer_storage = NULL;
+  if (SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")) {
+    buffer_storage = (PFNGLBUFFERSTORAGEPROC)SDL_GL_GetProcAddress("glBufferStorage");
+  }
+
+  return gen_buffers && delete_buffers && bind_buffer && buffer_data && map_buffer_range && unmap_buffer && fence_sync && client_wait_sync &&
+         delete_sync;
+}
+
+static void retire_fence(UploadRing *ring, int index) {
+  ring->latency_ms = (float)(clock_now_ns() - ring->fence_issued_ns[index]) / 1.0e6f;
+  delete_sync(ring->fences[index]);
+  ring->fences[index] = NULL;
+}
+
+bool upload_ring_init(UploadRing *ring, uint32_t width, uint32_t height) {
+  *ring = (UploadRing){0};
+  if (!load_functions())
+    return false;
+
+  ring->width = width;
+  ring->height = height;
+  GLsizeiptr size = (GLsizeiptr)width * height * sizeof(uint32_t);
+
+  gen_buffers(UPLOAD_RING_SIZE, ring->buffers);
+  ring->persistent = buffer_storage != NULL;
+  for (int i = 0; i < UPLOAD_RING_SIZE; i++) {
+    bind_buffer(GL_PIXEL_UNPACK_BUFFER, ring->buffers[i]);
+    if (ring->persistent) {
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      buffer_storage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+      ring->mapped[i] = map_buffer_range(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    } else {
+      buffer_data(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    }
+  }
+  bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  return true;
+}
+
+void upload_ring_free(UploadRing *ring) {
+  if (!ring->buffers[0])
+    return;
+
+  for (int i = 0; i < UPLOAD_RING_SIZE; i++) {
+    if (ring->fences[i]) {
+      delete_sync(ring->fences[i]);
+    }
+    if (ring->mapped[i]) {
+      bind_buffer(GL_PIXEL_UNPACK_BUFFER, ring->buffers[i]);
+      unmap_buffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+  }
+  bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  delete_buffers(UPLOAD_RING_SIZE, ring->buffers);
+  *ring = (UploadRing){0};
+}
+
+void upload_ring_poll(UploadRing *ring) {
+  for (int i = 0; i < UPLOAD_RING_SIZE; i++) {
+    if (!ring->fences[i])
+      continue;
+    GLenum status = client_wait_sync(ring->fences[i], 0, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+      retire_fence(ring, i);
+    }
+  }
+}
+
+// Waits for the buffer's last upload, false when it did not finish in time
+static bool wait_buffer(UploadRing *ring, int index) {
+  if (!ring->fences[index])
+    return true;
+
+  // Flush so the fence is guaranteed to signal, give up after a second
+  GLenum status = client_wait_sync(ring->fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+  if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    return false;
+  retire_fence(ring, index);
+  return true;
+}
+
+bool upload_ring_submit(UploadRing *ring, GLuint texture, const uint32_t *pixels, const Rect *rects, int count) {
+  int index = ring->current;
+  if (!wait_buffer(ring, index))
+    return false;
+
+  bind_buffer(GL_PIXEL_UNPACK_BUFFER, ring->buffers[index]);
+  uint32_t *mapped = ring->mapped[index];
+  if (!ring->persistent) {
+    // Only the copied rects are uploaded, the rest of the old contents can go
+    GLsizeiptr size = (GLsizeiptr)ring->width * ring->height * sizeof(uint32_t);
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    mapped = map_buffer_range(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+  }
+  if (!mapped) {
+    bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return false;
+  }
+
+  for (int i = 0; i < count; i++) {
+    Rect r = rects[i];
+    size_t row_bytes = (size_t)(r.x1 - r.x0) * sizeof(uint32_t);
+    for (int y = r.y0; y < r.y1; y++) {
+      size_t offset = (size_t)y * ring->width + r.x0;
+      memcpy(&mapped[offset], &pixels[offset], row_bytes);
+    }
+  }
+  if (!ring->persistent) {
+    unmap_buffer(GL_PIXEL_UNPACK_BUFFER);
+  }
+
+  // With an unpack buffer bound the pointer argument is an offset into it
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, ring->width);
+  for (int i = 0; i < count; i++) {
+    Rect r = rects[i];
+    size_t offset = ((size_t)r.y0 * ring->width + r.x0) * sizeof(uint32_t);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0, GL_BGRA, GL_UNSIGNED_BYTE, (const void *)offset);
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  ring->fences[index] = fence_sync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  ring->fence_issued_ns[index] = clock_now_ns();
+  ring->current = (index + 1) % UPLOAD_RING_SIZE;
+  return true;
+}
@@ -0,0 +1,45 @@
+#ifndef UPLOAD_RING_H
+#define UPLOAD_RING_H
+
+#include "SDL3/SDL_opengl.h"
+#include "damage.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define UPLOAD_RING_SIZE 3
+
+// Ring of pixel unpack buffers the damaged rects of a frame are copied into.
+// The upload of one buffer runs on the GPU while the next frame is being
+// rasterized, a fence per buffer tells when it can be written again.
+//
+// The rasterizer reads back what it blends over, so it always draws into the
+// surface's own buffer. The buffers are only ever written, their mappings may
+// be uncached.
+typedef struct {
+  GLuint buffers[UPLOAD_RING_SIZE];
+  GLsync fences[UPLOAD_RING_SIZE];
+  uint64_t fence_issued_ns[UPLOAD_RING_SIZE];
+  uint32_t *mapped[UPLOAD_RING_SIZE];
+  int current;
+
+  // Persistently mapped through GL_ARB_buffer_storage, otherwise mapped per frame
+  bool persistent;
+  uint32_t width;
+  uint32_t height;
+
+  // Fence issue to signal time of the last completed upload
+  float latency_ms;
+} UploadRing;
+
+// False when the GL context lacks what the ring needs
+bool upload_ring_init(UploadRing *ring, uint32_t width, uint32_t height);
+void upload_ring_free(UploadRing *ring);
+
+// Retires finished uploads and updates latency_ms without blocking
+void upload_ring_poll(UploadRing *ring);
+// Copies rects of pixels, ring-sized rows, into the next buffer and uploads
+// them to texture. False when the buffer is still busy after a wait or could
+// not be mapped, nothing was uploaded then.
+bool upload_ring_submit(UploadRing *ring, GLuint texture, const uint32_t *pixels, const Rect *rects, int count);
+
+#endif // UPLOAD_RING_H